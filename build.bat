@@ -3,3 +3,6 @@
 rem download compiler here: https://github.com/skeeto/w64devkit/
 
 gcc src/*.c src/lib/*.c -o blink.exe -std=c99 -lgdi32 -luser32 -lwinmm -ldwmapi -O3 -s -mwindows
+gcc tools/bench.c src/blink.c src/lib/*.c -Isrc -o bench.exe -std=c99 -lgdi32 -luser32 -lwinmm -ldwmapi -O3 -s
+gcc tools/bimg.c src/blink.c src/lib/*.c -Isrc -o bimg.exe -std=c99 -lgdi32 -luser32 -lwinmm -ldwmapi -O3 -s
+gcc tests/golden.c src/blink.c src/lib/*.c -Isrc -o golden.exe -std=c99 -lgdi32 -luser32 -lwinmm -ldwmapi -O3 -s
@@ -0,0 +1,15 @@
+#!/bin/sh
+
+# headless build: renders into ctx->screen, never opens a window;
+# exits on SIGINT/SIGTERM or after $BLINK_FRAMES frames
+
+gcc src/*.c src/lib/*.c -o blink -std=c99 -lm -lpthread -ldl -O3 -s
+
+# rasterizer benchmarks: ./bench [filter] [seconds per case], one JSON object per line
+gcc tools/bench.c src/blink.c src/lib/*.c -Isrc -o bench -std=c99 -lm -lpthread -ldl -O3 -s
+
+# image converter: ./bimg [-p] [-s] input.png output.bimg
+gcc tools/bimg.c src/blink.c src/lib/*.c -Isrc -o bimg -std=c99 -lm -lpthread -ldl -O3 -s
+
+# golden image tests: ./golden [-u] from the repo root, compares against tests/golden/*.png
+gcc tests/golden.c src/blink.c src/lib/*.c -Isrc -o golden -std=c99 -lm -lpthread -ldl -O3 -s
@@ -1,3 +1,7 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "blink.h"
 
 #define STBI_NO_STDIO
@@ -6,10 +10,36 @@
 #define STBI_ONLY_PNG
 #define STB_IMAGE_IMPLEMENTATION
 #include "lib/stb_image.h"
+#include "lib/microtar.h"
+#include "lib/miniaudio.h"
+#define STB_VORBIS_HEADER_ONLY
+#include "lib/stb_vorbis.c"
+#include "lib/wren.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BLINK_X86
+#define BLINK_SSE2 __attribute__((target("sse2")))
+#define BLINK_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
 
+#include <signal.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef BLINK_WIN32
 #ifndef DWMWA_USE_IMMERSIVE_DARK_MODE
 #define DWMWA_USE_IMMERSIVE_DARK_MODE 20
 #endif
+#endif
 
 enum {
     BLINK_INPUT_DOWN = (1 << 0),
@@ -17,6 +47,8 @@ enum {
     BLINK_INPUT_RELEASED = (1 << 2)
 };
 
+#define BLINK_TILE_SIZE 64
+
 #define blink_expect(x) if (!(x)) { blink_panic("assertion failure: %s", #x); }
 
 static void blink_panic(const char *fmt, ...) {
@@ -47,6 +79,7 @@ static blink_Rect blink_intersect_rects(blink_Rect a, blink_Rect b) {
 }
 
 static inline blink_Color blink_blend_pixel(blink_Color dst, blink_Color src) {
+    if (src.a == 0xff) { return src; }
     blink_Color res;
     res.w = (dst.w & 0xff00ff) + ((((src.w & 0xff00ff) - (dst.w & 0xff00ff)) * src.a) >> 8);
     res.g = dst.g + (((src.g - dst.g) * src.a) >> 8);
@@ -57,6 +90,7 @@ static inline blink_Color blink_blend_pixel(blink_Color dst, blink_Color src) {
 
 static inline blink_Color blink_blend_pixel2(blink_Color dst, blink_Color src, blink_Color clr) {
     src.a = (src.a * clr.a) >> 8;
+    if (src.a == 0) { return dst; }
     int ia = 0xff - src.a;
     dst.r = ((src.r * clr.r * src.a) >> 16) + ((dst.r * ia) >> 8);
     dst.g = ((src.g * clr.g * src.a) >> 16) + ((dst.g * ia) >> 8);
@@ -72,422 +106,1037 @@ static inline blink_Color blink_blend_pixel3(blink_Color dst, blink_Color src, b
     return blink_blend_pixel2(dst, src, clr);
 }
 
-static bool blink_check_column(blink_Image *img, int x, int y, int h) {
-    while (h > 0) {
-        if (img->pixels[x + y * img->w].a) { return true; }
-        y++; h--;
-    }
-    return false;
+static inline uint8_t blink_div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
 }
 
-static blink_Font *blink_load_font_from_image(blink_Image *img) {
-    if (!img) { return NULL; }
-    blink_Font *font = blink_alloc(sizeof(blink_Font));
-    font->image = img;
+static inline blink_Color blink_premul_color(blink_Color c) {
+    c.r = blink_div255(c.r * c.a);
+    c.g = blink_div255(c.g * c.a);
+    c.b = blink_div255(c.b * c.a);
+    return c;
+}
 
-    for (int i = 0; i < 256; i++) {
-        blink_Glyph *g = &font->glyphs[i];
-        blink_Rect r = {
-            (img->w / 16) * (i % 16),
-            (img->h / 16) * (i / 16),
-            img->w / 16,
-            img->h / 16
-        };
-        for (int x = r.x + r.w - 1; x >= r.x; x--) {
-            if (blink_check_column(font->image, x, r.y, r.h)) { break; }
-            r.w--;
-        }
-        for (int x = r.x; x < r.x + r.w; x++) {
-            if (blink_check_column(font->image, x, r.y, r.h)) { break; }
-            r.x++;
-            r.w--;
-        }
-        g->xadv = r.w + 1;
-        g->rect = r;
-    }
+static inline blink_Color blink_premul_pixel(blink_Color dst, blink_Color src) {
+    int ia = 0xff - src.a;
+    dst.r = blink_min(255, src.r + blink_div255(dst.r * ia));
+    dst.g = blink_min(255, src.g + blink_div255(dst.g * ia));
+    dst.b = blink_min(255, src.b + blink_div255(dst.b * ia));
+    dst.a = src.a + blink_div255(dst.a * ia);
+    return dst;
+}
 
-    font->glyphs[' '].rect = (blink_Rect) {0};
-    font->glyphs[' '].xadv = font->glyphs['a'].xadv;
+static inline blink_Color blink_premul_pixel2(blink_Color dst, blink_Color src, blink_Color k) {
+    src.r = blink_div255(src.r * k.r);
+    src.g = blink_div255(src.g * k.g);
+    src.b = blink_div255(src.b * k.b);
+    src.a = blink_div255(src.a * k.a);
+    return blink_premul_pixel(dst, src);
+}
 
-    return font;
+static inline blink_Color blink_premul_pixel3(blink_Color dst, blink_Color src, blink_Color k, blink_Color add) {
+    src.r = blink_min(src.a, src.r + blink_div255(add.r * src.a));
+    src.g = blink_min(src.a, src.g + blink_div255(add.g * src.a));
+    src.b = blink_min(src.a, src.b + blink_div255(add.b * src.a));
+    return blink_premul_pixel2(dst, src, k);
 }
 
-static blink_Rect blink_get_adjusted_window_rect(blink_Context *ctx) {
-    float src_ar = (float) ctx->screen->h / ctx->screen->w;
-    float dst_ar = (float) ctx->height / ctx->width;
-    int w, h;
-    if (src_ar < dst_ar) {
-        w = ctx->width; h = ceil(w * src_ar);
-    } else {
-        h = ctx->height; w = ceil(h / src_ar);
+/* scalar tail shared by the SIMD premultiplied blits, so every pixel goes
+ * through the same formula whatever its position in the span */
+static inline void blink_blit_pm_tail(blink_Color *d, const blink_Color *s, int n, blink_Color k, blink_Color add, bool usemul, bool useadd) {
+    for (int i = 0; i < n; i++) {
+        if (useadd) {
+            d[i] = blink_premul_pixel3(d[i], s[i], k, add);
+        } else if (usemul) {
+            d[i] = blink_premul_pixel2(d[i], s[i], k);
+        } else {
+            d[i] = blink_premul_pixel(d[i], s[i]);
+        }
     }
-    return blink_rect((ctx->width - w) / 2, (ctx->height - h) / 2, w, h);
 }
 
-static LRESULT CALLBACK blink_wndproc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
-    blink_Context *ctx = (void*) GetProp(hwnd, "blink_Context");
-
-    switch (message) {
-    case WM_PAINT:
-        BITMAPINFO bmi = {
-            .bmiHeader.biSize = sizeof(BITMAPINFOHEADER),
-            .bmiHeader.biBitCount = 32,
-            .bmiHeader.biCompression = BI_RGB,
-            .bmiHeader.biPlanes = 1,
-            .bmiHeader.biWidth = ctx->screen->w,
-            .bmiHeader.biHeight = -ctx->screen->h
-        };
-
-        blink_Rect wr = blink_get_adjusted_window_rect(ctx);
-
-        StretchDIBits(ctx->hdc,
-            wr.x, wr.y, wr.w, wr.h,
-            0, 0, ctx->screen->w, ctx->screen->h,
-            ctx->screen->pixels, &bmi, DIB_RGB_COLORS, SRCCOPY);
+typedef void (*blink_SpanFn)(blink_Color *d, int n, blink_Color c);
+typedef void (*blink_BlitFn)(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add);
+typedef void (*blink_MaskFn)(blink_Color *d, const uint8_t *m, int n, blink_Color c);
+typedef void (*blink_GatherFn)(blink_Color *d, const blink_Color *row, int n, int sx, int step);
+typedef void (*blink_MixFn)(float *d, const float *s, int n, float l, float r);
 
-        ValidateRect(hwnd, 0);
-        break;
+typedef struct {
+    blink_SpanFn fill;
+    blink_SpanFn blend;
+    blink_BlitFn blit;
+    blink_BlitFn blit_mul;
+    blink_BlitFn blit_mul_add;
+    blink_BlitFn blit_pm;
+    blink_BlitFn blit_pm_mul;
+    blink_BlitFn blit_pm_mul_add;
+    blink_MaskFn mask;
+    blink_MaskFn mask_mul;
+    blink_GatherFn gather;
+    blink_MixFn mix_mono;
+    blink_MixFn mix_stereo;
+} blink_Kernels;
 
-    case WM_SETCURSOR:
-        if (ctx->hide_cursor && LOWORD(lparam) == HTCLIENT) {
-            SetCursor(0);
-            break;
-        }
-        goto unhandled;
+static blink_Kernels blink_kernels;
 
-    case WM_KEYDOWN:
-    case WM_SYSKEYDOWN:
-        if (lparam & (1 << 30)) { break; }
-        ctx->key_state[(uint8_t) wparam] = BLINK_INPUT_DOWN | BLINK_INPUT_PRESSED;
-        break;
+static void blink_fill_scalar(blink_Color *d, int n, blink_Color c) {
+    for (int i = 0; i < n; i++) { d[i] = c; }
+}
 
-    case WM_KEYUP:
-    case WM_SYSKEYUP:
-        ctx->key_state[(uint8_t) wparam] &= ~BLINK_INPUT_DOWN;
-        ctx->key_state[(uint8_t) wparam] |= BLINK_INPUT_RELEASED;
-        break;
+static void blink_blend_scalar(blink_Color *d, int n, blink_Color c) {
+    for (int i = 0; i < n; i++) { d[i] = blink_blend_pixel(d[i], c); }
+}
 
-    case WM_CHAR:
-        if (wparam < 32) { break; }
-        for (int i = 0; i < blink_lengthof(ctx->char_buf); i++) {
-            if (ctx->char_buf[i]) { continue; }
-            ctx->char_buf[i] = wparam;
-            break;
-        }
-        break;
+static void blink_blit_scalar(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    for (int i = 0; i < n; i++) { d[i] = blink_blend_pixel(d[i], s[i]); }
+}
 
-    case WM_LBUTTONDOWN: case WM_LBUTTONUP:
-    case WM_RBUTTONDOWN: case WM_RBUTTONUP:
-    case WM_MBUTTONDOWN: case WM_MBUTTONUP:
-        int button = (message == WM_LBUTTONDOWN || message == WM_LBUTTONUP) ? 1 :
-                     (message == WM_RBUTTONDOWN || message == WM_RBUTTONUP) ? 2 : 3;
-        if (message == WM_LBUTTONDOWN || message == WM_RBUTTONDOWN || message == WM_MBUTTONDOWN) {
-            SetCapture(hwnd);
-            ctx->mouse_state[button] = BLINK_INPUT_DOWN | BLINK_INPUT_PRESSED;
-        } else {
-            ReleaseCapture();
-            ctx->mouse_state[button] &= ~BLINK_INPUT_DOWN;
-            ctx->mouse_state[button] |= BLINK_INPUT_RELEASED;
-        }
+static void blink_blit_mul_scalar(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    for (int i = 0; i < n; i++) { d[i] = blink_blend_pixel2(d[i], s[i], mul); }
+}
 
-    case WM_MOUSEMOVE:
-        wr = blink_get_adjusted_window_rect(ctx);
-        int prevx = ctx->mouse_pos.x;
-        int prevy = ctx->mouse_pos.y;
-        ctx->mouse_pos.x = (GET_X_LPARAM(lparam) - wr.x) * ctx->screen->w / wr.w;
-        ctx->mouse_pos.y = (GET_Y_LPARAM(lparam) - wr.y) * ctx->screen->h / wr.h;
-        ctx->mouse_delta.x += ctx->mouse_pos.x - prevx;
-        ctx->mouse_delta.y += ctx->mouse_pos.y - prevy;
-        break;
+static void blink_blit_mul_add_scalar(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    for (int i = 0; i < n; i++) { d[i] = blink_blend_pixel3(d[i], s[i], mul, add); }
+}
 
-    case WM_MOUSEWHEEL:
-        ctx->mouse_scroll = (float) GET_WHEEL_DELTA_WPARAM(wparam) / WHEEL_DELTA;
-        break;
+static void blink_blit_pm_scalar(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    for (int i = 0; i < n; i++) { d[i] = blink_premul_pixel(d[i], s[i]); }
+}
 
-    case WM_SIZE:
-        if (wparam != SIZE_MINIMIZED) {
-            ctx->width = LOWORD(lparam);
-            ctx->height = HIWORD(lparam);
-            PAINTSTRUCT ps;
-            HDC hdc = BeginPaint(hwnd, &ps);
-            HBRUSH brush = CreateSolidBrush(RGB(0, 0, 0));
-            FillRect(hdc, &ps.rcPaint, brush);
-            DeleteObject(brush);
-            EndPaint(hwnd, &ps);
-            RedrawWindow(ctx->hwnd, 0, 0, RDW_INVALIDATE | RDW_UPDATENOW);
-        }
-        break;
+static void blink_blit_pm_mul_scalar(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_Color k = blink_premul_color(mul);
+    for (int i = 0; i < n; i++) { d[i] = blink_premul_pixel2(d[i], s[i], k); }
+}
 
-    case WM_QUIT:
-    case WM_CLOSE:
-        ctx->should_quit = true;
-        break;
+static void blink_blit_pm_mul_add_scalar(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_Color k = blink_premul_color(mul);
+    for (int i = 0; i < n; i++) { d[i] = blink_premul_pixel3(d[i], s[i], k, add); }
+}
 
-    default:
-unhandled:
-        return DefWindowProc(hwnd, message, wparam, lparam);
+static void blink_mask_scalar(blink_Color *d, const uint8_t *m, int n, blink_Color c) {
+    for (int i = 0; i < n; i++) {
+        c.a = m[i];
+        d[i] = blink_blend_pixel(d[i], c);
     }
-
-    return 0;
 }
 
-static void *blink_font_data;
-static int blink_font_size;
-
-blink_Context *blink_create(const char *title, int width, int height, int scale) {
-    blink_Context *ctx = blink_alloc(sizeof(blink_Context));
-
-    ctx->screen = blink_create_image(width, height);
-    ctx->clip = blink_rect(0, 0, width, height);
-
-    RegisterClass(&(WNDCLASS) {
-        .style = CS_OWNDC | CS_HREDRAW | CS_VREDRAW,
-        .lpfnWndProc = blink_wndproc,
-        .hCursor = LoadCursor(0, IDC_ARROW),
-        .lpszClassName = title
-    });
-
-    width *= scale;
-    height *= scale;
-
-    RECT rect = { .right = width, .bottom = height };
-    int style = WS_OVERLAPPEDWINDOW;
-    AdjustWindowRect(&rect, style, 0);
-    ctx->hwnd = CreateWindow(
-        title, title, style,
-        CW_USEDEFAULT, CW_USEDEFAULT,
-        rect.right - rect.left, rect.bottom - rect.top,
-        0, 0, 0, 0
-    );
-    SetProp(ctx->hwnd, "blink_Context", ctx);
+static void blink_mask_mul_scalar(blink_Color *d, const uint8_t *m, int n, blink_Color c) {
+    for (int i = 0; i < n; i++) {
+        d[i] = blink_blend_pixel2(d[i], blink_rgba(0xff, 0xff, 0xff, m[i]), c);
+    }
+}
 
-    BOOL dark = TRUE;
-    DwmSetWindowAttribute(ctx->hwnd, DWMWA_USE_IMMERSIVE_DARK_MODE, &dark, sizeof(dark));
+static void blink_gather_scalar(blink_Color *d, const blink_Color *row, int n, int sx, int step) {
+    for (int i = 0; i < n; i++) {
+        d[i] = row[sx >> 10];
+        sx += step;
+    }
+}
 
-    ShowWindow(ctx->hwnd, SW_NORMAL);
-    ctx->hdc = GetDC(ctx->hwnd);
+static void blink_mix_mono_scalar(float *d, const float *s, int n, float l, float r) {
+    for (int i = 0; i < n; i++) {
+        d[i * 2] += s[i] * l;
+        d[i * 2 + 1] += s[i] * r;
+    }
+}
 
-    timeBeginPeriod(1);
-    ctx->prev_time = clock() / 1000.0;
+static void blink_mix_stereo_scalar(float *d, const float *s, int n, float l, float r) {
+    for (int i = 0; i < n; i++) {
+        d[i * 2] += s[i * 2] * l;
+        d[i * 2 + 1] += s[i * 2 + 1] * r;
+    }
+}
 
-    ctx->font = blink_load_font_mem(blink_font_data, blink_font_size);
+#ifdef BLINK_X86
+/* All channel math is done on 16-bit lanes: (s - d) * a wraps, but only bits
+ * 8..15 of the product survive the final mask, which is exactly what the
+ * scalar blink_blend_pixel() computes. */
 
-    return ctx;
+BLINK_SSE2 static inline __m128i blink_lerp_sse2(__m128i d, __m128i s, __m128i a) {
+    __m128i t = _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(s, d), a), 8);
+    return _mm_and_si128(_mm_add_epi16(d, t), _mm_set1_epi16(0xff));
 }
 
-void blink_destroy(blink_Context *ctx) {
-    ReleaseDC(ctx->hwnd, ctx->hdc);
-    DestroyWindow(ctx->hwnd);
-    blink_destroy_image(ctx->screen);
-    blink_destroy_font(ctx->font);
-    free(ctx);
+BLINK_SSE2 static inline __m128i blink_alpha_sse2(__m128i c) {
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, 0xff), 0xff);
 }
 
-bool blink_update(blink_Context *ctx, double *dt) {
-    RedrawWindow(ctx->hwnd, 0, 0, RDW_INVALIDATE | RDW_UPDATENOW);
+BLINK_SSE2 static inline __m128i blink_mul_sse2(__m128i d, __m128i s, __m128i clr, __m128i ca) {
+    __m128i sa = _mm_srli_epi16(_mm_mullo_epi16(blink_alpha_sse2(s), ca), 8);
+    __m128i ia = _mm_sub_epi16(_mm_set1_epi16(0xff), sa);
+    __m128i t = _mm_mulhi_epu16(_mm_mullo_epi16(s, clr), sa);
+    return _mm_add_epi16(t, _mm_srli_epi16(_mm_mullo_epi16(d, ia), 8));
+}
 
-    double now = clock() / 1000.0;
-    double wait = (ctx->prev_time + ctx->step_time) - now;
-    double prev = ctx->prev_time;
-    if (wait > 0) {
-        Sleep(wait * 1000);
-        ctx->prev_time += ctx->step_time;
-    } else {
-        ctx->prev_time = now;
+BLINK_SSE2 static void blink_fill_sse2(blink_Color *d, int n, blink_Color c) {
+    __m128i v = _mm_set1_epi32(c.w);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128((__m128i*) (d + i), v);
+        _mm_storeu_si128((__m128i*) (d + i + 4), v);
     }
-    if (dt) { *dt = ctx->prev_time - prev; }
+    for (; i < n; i++) { d[i] = c; }
+}
 
-    memset(ctx->char_buf, 0, sizeof(ctx->char_buf));
-    for (int i = 0; i < sizeof(ctx->key_state); i++) {
-        ctx->key_state[i] &= ~(BLINK_INPUT_PRESSED | BLINK_INPUT_RELEASED);
+BLINK_SSE2 static void blink_blend_sse2(blink_Color *d, int n, blink_Color c) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i amask = _mm_set1_epi32(0xff000000);
+    __m128i s = _mm_unpacklo_epi8(_mm_set1_epi32(c.w), zero);
+    __m128i a = _mm_set1_epi16(c.a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((__m128i*) (d + i));
+        __m128i lo = blink_lerp_sse2(_mm_unpacklo_epi8(v, zero), s, a);
+        __m128i hi = blink_lerp_sse2(_mm_unpackhi_epi8(v, zero), s, a);
+        __m128i r = _mm_packus_epi16(lo, hi);
+        r = _mm_or_si128(_mm_andnot_si128(amask, r), _mm_and_si128(v, amask));
+        _mm_storeu_si128((__m128i*) (d + i), r);
     }
-    for (int i = 0; i < sizeof(ctx->mouse_state); i++) {
-        ctx->mouse_state[i] &= ~(BLINK_INPUT_PRESSED | BLINK_INPUT_RELEASED);
-    }
-    ctx->mouse_scroll = 0;
+    for (; i < n; i++) { d[i] = blink_blend_pixel(d[i], c); }
+}
 
-    MSG msg;
-    while (PeekMessage(&msg, ctx->hwnd, 0, 0, PM_REMOVE)) {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+BLINK_SSE2 static void blink_blit_sse2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i amask = _mm_set1_epi32(0xff000000);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i sv = _mm_loadu_si128((__m128i*) (s + i));
+        __m128i sa = _mm_and_si128(sv, amask);
+        __m128i opaque = _mm_cmpeq_epi32(sa, amask);
+        int m = _mm_movemask_epi8(opaque);
+        if (m == 0xffff) {
+            _mm_storeu_si128((__m128i*) (d + i), sv);
+            continue;
+        }
+        if (m == 0 && _mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) == 0xffff) { continue; }
+        __m128i v = _mm_loadu_si128((__m128i*) (d + i));
+        __m128i slo = _mm_unpacklo_epi8(sv, zero);
+        __m128i shi = _mm_unpackhi_epi8(sv, zero);
+        __m128i lo = blink_lerp_sse2(_mm_unpacklo_epi8(v, zero), slo, blink_alpha_sse2(slo));
+        __m128i hi = blink_lerp_sse2(_mm_unpackhi_epi8(v, zero), shi, blink_alpha_sse2(shi));
+        __m128i r = _mm_packus_epi16(lo, hi);
+        r = _mm_or_si128(_mm_andnot_si128(amask, r), _mm_and_si128(v, amask));
+        r = _mm_or_si128(_mm_and_si128(opaque, sv), _mm_andnot_si128(opaque, r));
+        _mm_storeu_si128((__m128i*) (d + i), r);
     }
-
-    return !ctx->should_quit;
+    for (; i < n; i++) { d[i] = blink_blend_pixel(d[i], s[i]); }
 }
 
-void blink_set_target_fps(blink_Context *ctx, int fps) {
-    if (fps < 1) {
-        ctx->step_time = 0;
-    } else {
-        ctx->step_time = 1.0 / (double)fps;
+BLINK_SSE2 static inline void blink_blit_mul_sse2_(blink_Color *d, const blink_Color *s, int n, blink_Color mul, __m128i add) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i amask = _mm_set1_epi32(0xff000000);
+    __m128i clr = _mm_unpacklo_epi8(_mm_set1_epi32(mul.w), zero);
+    __m128i ca = _mm_set1_epi16(mul.a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i sv = _mm_loadu_si128((__m128i*) (s + i));
+        __m128i v = _mm_loadu_si128((__m128i*) (d + i));
+        __m128i slo = _mm_unpacklo_epi8(sv, zero);
+        __m128i shi = _mm_unpackhi_epi8(sv, zero);
+        __m128i sa = _mm_packus_epi16(
+            _mm_srli_epi16(_mm_mullo_epi16(blink_alpha_sse2(slo), ca), 8),
+            _mm_srli_epi16(_mm_mullo_epi16(blink_alpha_sse2(shi), ca), 8));
+        __m128i keep = _mm_cmpeq_epi32(_mm_and_si128(sa, amask), zero);
+        if (_mm_movemask_epi8(keep) == 0xffff) { continue; }
+        sv = _mm_adds_epu8(sv, add);
+        __m128i lo = blink_mul_sse2(_mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(sv, zero), clr, ca);
+        __m128i hi = blink_mul_sse2(_mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(sv, zero), clr, ca);
+        __m128i r = _mm_packus_epi16(lo, hi);
+        r = _mm_or_si128(_mm_andnot_si128(amask, r), _mm_and_si128(v, amask));
+        r = _mm_or_si128(_mm_and_si128(keep, v), _mm_andnot_si128(keep, r));
+        _mm_storeu_si128((__m128i*) (d + i), r);
     }
+    blink_Color a = { .w = _mm_cvtsi128_si32(add) };
+    for (; i < n; i++) { d[i] = blink_blend_pixel3(d[i], s[i], mul, a); }
 }
 
-void blink_set_cursor_hidden(blink_Context *ctx, bool hidden) {
-    ctx->hide_cursor = hidden;
+BLINK_SSE2 static void blink_blit_mul_sse2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_mul_sse2_(d, s, n, mul, _mm_setzero_si128());
 }
 
-void *blink_read_file(const char *filename, int *len) {
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) { return NULL; }
-    fseek(fp, 0, SEEK_END);
-    int n = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-    char *buf = blink_alloc(n + 1);
-    fread(buf, 1, n, fp);
-    fclose(fp);
-    if (len) { *len = n; }
-    return buf;
+BLINK_SSE2 static void blink_blit_mul_add_sse2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_mul_sse2_(d, s, n, mul, _mm_set1_epi32(add.w & 0xffffff));
 }
 
-blink_Image *blink_create_image(int width, int height) {
-    blink_expect(width > 0 && height > 0);
-    blink_Image *img = blink_alloc(sizeof(blink_Image) + width * height * sizeof(blink_Color));
-    img->pixels = (void*) (img + 1);
-    img->w = width;
-    img->h = height;
-    return img;
+BLINK_SSE2 static inline __m128i blink_div255_sse2(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
 }
 
-blink_Image *blink_load_image_mem(void *data, int len) {
-    int x, y;
-    unsigned char *png = stbi_load_from_memory(data, len, &x, &y, NULL, 4);
-    if (!png) { return NULL; }
-    blink_Image *img = blink_create_image(x, y);
-    memcpy(img->pixels, png, x * y * 4);
-    free(png);
+BLINK_SSE2 static inline __m128i blink_premul_sse2(__m128i d, __m128i s, __m128i k, __m128i add, bool mul, bool addc) {
+    if (addc) {
+        __m128i a = blink_alpha_sse2(s);
+        s = _mm_min_epi16(_mm_add_epi16(s, blink_div255_sse2(_mm_mullo_epi16(add, a))), a);
+    }
+    if (mul) { s = blink_div255_sse2(_mm_mullo_epi16(s, k)); }
+    __m128i ia = _mm_sub_epi16(_mm_set1_epi16(0xff), blink_alpha_sse2(s));
+    return _mm_add_epi16(s, blink_div255_sse2(_mm_mullo_epi16(d, ia)));
+}
 
-    for (int i = 0; i < x * y; i++) {
-        blink_Color *p = &img->pixels[i];
-        uint8_t t = p->r;
-        p->r = p->b;
-        p->b = t;
+BLINK_SSE2 static inline void blink_blit_pm_sse2_(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add, bool usemul, bool useadd) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i amask = _mm_set1_epi32(0xff000000);
+    blink_Color k = blink_premul_color(mul);
+    add.a = 0;
+    __m128i k16 = _mm_unpacklo_epi8(_mm_set1_epi32(k.w), zero);
+    __m128i add16 = _mm_unpacklo_epi8(_mm_set1_epi32(add.w), zero);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i sv = _mm_loadu_si128((__m128i*) (s + i));
+        __m128i sa = _mm_and_si128(sv, amask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(useadd ? sa : sv, zero)) == 0xffff) { continue; }
+        if (!usemul && !useadd && _mm_movemask_epi8(_mm_cmpeq_epi32(sa, amask)) == 0xffff) {
+            _mm_storeu_si128((__m128i*) (d + i), sv);
+            continue;
+        }
+        __m128i v = _mm_loadu_si128((__m128i*) (d + i));
+        __m128i lo = blink_premul_sse2(_mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(sv, zero), k16, add16, usemul, useadd);
+        __m128i hi = blink_premul_sse2(_mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(sv, zero), k16, add16, usemul, useadd);
+        _mm_storeu_si128((__m128i*) (d + i), _mm_packus_epi16(lo, hi));
     }
+    blink_blit_pm_tail(d + i, s + i, n - i, k, add, usemul, useadd);
+}
 
-    return img;
+BLINK_SSE2 static void blink_blit_pm_sse2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_pm_sse2_(d, s, n, BLINK_WHITE, BLINK_BLACK, false, false);
 }
 
-blink_Image *blink_load_image_file(const char *filename) {
-    int len;
-    void *data = blink_read_file(filename, &len);
-    if (!data) { return NULL; }
-    blink_Image *res = blink_load_image_mem(data, len);
-    free(data);
-    return res;
+BLINK_SSE2 static void blink_blit_pm_mul_sse2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_pm_sse2_(d, s, n, mul, BLINK_BLACK, true, false);
 }
 
-void blink_destroy_image(blink_Image *img) {
-    free(img);
+BLINK_SSE2 static void blink_blit_pm_mul_add_sse2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_pm_sse2_(d, s, n, mul, add, true, true);
 }
 
-blink_Font *blink_load_font_mem(void *data, int len) {
-    return blink_load_font_from_image(blink_load_image_mem(data, len));
+BLINK_SSE2 static inline void blink_expand_mask_sse2(const uint8_t *m, __m128i *lo, __m128i *hi) {
+    __m128i zero = _mm_setzero_si128();
+    int32_t w;
+    memcpy(&w, m, 4);
+    __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(w), zero), zero);
+    v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+    *lo = _mm_unpacklo_epi32(v, v);
+    *hi = _mm_unpackhi_epi32(v, v);
 }
 
-blink_Font *blink_load_font_file(const char *filename) {
-    return blink_load_font_from_image(blink_load_image_file(filename));
+BLINK_SSE2 static void blink_mask_sse2(blink_Color *d, const uint8_t *m, int n, blink_Color c) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i amask = _mm_set1_epi32(0xff000000);
+    __m128i s = _mm_unpacklo_epi8(_mm_set1_epi32(c.w), zero);
+    __m128i opaque_color = _mm_set1_epi32(c.w | 0xff000000);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t w;
+        memcpy(&w, m + i, 4);
+        if (w == 0) { continue; }
+        if (w == -1) {
+            _mm_storeu_si128((__m128i*) (d + i), opaque_color);
+            continue;
+        }
+        __m128i alo, ahi;
+        blink_expand_mask_sse2(m + i, &alo, &ahi);
+        __m128i v = _mm_loadu_si128((__m128i*) (d + i));
+        __m128i lo = blink_lerp_sse2(_mm_unpacklo_epi8(v, zero), s, alo);
+        __m128i hi = blink_lerp_sse2(_mm_unpackhi_epi8(v, zero), s, ahi);
+        __m128i r = _mm_packus_epi16(lo, hi);
+        r = _mm_or_si128(_mm_andnot_si128(amask, r), _mm_and_si128(v, amask));
+        __m128i opaque = _mm_cmpeq_epi32(_mm_packus_epi16(alo, ahi), _mm_set1_epi32(-1));
+        r = _mm_or_si128(_mm_and_si128(opaque, opaque_color), _mm_andnot_si128(opaque, r));
+        _mm_storeu_si128((__m128i*) (d + i), r);
+    }
+    blink_mask_scalar(d + i, m + i, n - i, c);
 }
 
-void blink_destroy_font(blink_Font *font) {
-    free(font->image);
-    free(font);
+BLINK_SSE2 static void blink_mask_mul_sse2(blink_Color *d, const uint8_t *m, int n, blink_Color c) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i amask = _mm_set1_epi32(0xff000000);
+    __m128i cw = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32(c.w), zero), _mm_set1_epi16(0xff));
+    __m128i ca = _mm_set1_epi16(c.a);
+    __m128i full = _mm_set1_epi16(0xff);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t w;
+        memcpy(&w, m + i, 4);
+        if (w == 0) { continue; }
+        __m128i alo, ahi;
+        blink_expand_mask_sse2(m + i, &alo, &ahi);
+        alo = _mm_srli_epi16(_mm_mullo_epi16(alo, ca), 8);
+        ahi = _mm_srli_epi16(_mm_mullo_epi16(ahi, ca), 8);
+        __m128i v = _mm_loadu_si128((__m128i*) (d + i));
+        __m128i dlo = _mm_unpacklo_epi8(v, zero);
+        __m128i dhi = _mm_unpackhi_epi8(v, zero);
+        __m128i lo = _mm_add_epi16(_mm_mulhi_epu16(cw, alo), _mm_srli_epi16(_mm_mullo_epi16(dlo, _mm_sub_epi16(full, alo)), 8));
+        __m128i hi = _mm_add_epi16(_mm_mulhi_epu16(cw, ahi), _mm_srli_epi16(_mm_mullo_epi16(dhi, _mm_sub_epi16(full, ahi)), 8));
+        __m128i r = _mm_packus_epi16(lo, hi);
+        r = _mm_or_si128(_mm_andnot_si128(amask, r), _mm_and_si128(v, amask));
+        __m128i keep = _mm_cmpeq_epi32(_mm_packus_epi16(alo, ahi), zero);
+        r = _mm_or_si128(_mm_and_si128(keep, v), _mm_andnot_si128(keep, r));
+        _mm_storeu_si128((__m128i*) (d + i), r);
+    }
+    blink_mask_mul_scalar(d + i, m + i, n - i, c);
 }
 
-int blink_text_width(blink_Font *font, const char *text) {
-    int x = 0;
-    for (uint8_t *p = (void*) text; *p; p++) {
-        x += font->glyphs[*p].xadv;
+BLINK_SSE2 static void blink_mix_mono_sse2(float *d, const float *s, int n, float l, float r) {
+    __m128 g = _mm_setr_ps(l, r, l, r);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(s + i);
+        float *p = d + i * 2;
+        _mm_storeu_ps(p, _mm_add_ps(_mm_loadu_ps(p), _mm_mul_ps(_mm_unpacklo_ps(v, v), g)));
+        _mm_storeu_ps(p + 4, _mm_add_ps(_mm_loadu_ps(p + 4), _mm_mul_ps(_mm_unpackhi_ps(v, v), g)));
     }
-    return x;
+    blink_mix_mono_scalar(d + i * 2, s + i, n - i, l, r);
 }
 
-int blink_get_char(blink_Context *ctx) {
-    for (int i = 0; i < blink_lengthof(ctx->char_buf); i++) {
-        if (!ctx->char_buf[i]) { continue; }
-        int res = ctx->char_buf[i];
-        ctx->char_buf[i] = 0;
-        return res;
+BLINK_SSE2 static void blink_mix_stereo_sse2(float *d, const float *s, int n, float l, float r) {
+    __m128 g = _mm_setr_ps(l, r, l, r);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float *p = d + i * 2;
+        _mm_storeu_ps(p, _mm_add_ps(_mm_loadu_ps(p), _mm_mul_ps(_mm_loadu_ps(s + i * 2), g)));
+    }
+    blink_mix_stereo_scalar(d + i * 2, s + i * 2, n - i, l, r);
+}
+
+BLINK_AVX2 static inline __m256i blink_lerp_avx2(__m256i d, __m256i s, __m256i a) {
+    __m256i t = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(s, d), a), 8);
+    return _mm256_and_si256(_mm256_add_epi16(d, t), _mm256_set1_epi16(0xff));
+}
+
+BLINK_AVX2 static inline __m256i blink_alpha_avx2(__m256i c) {
+    return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, 0xff), 0xff);
+}
+
+BLINK_AVX2 static inline __m256i blink_mul_avx2(__m256i d, __m256i s, __m256i clr, __m256i ca) {
+    __m256i sa = _mm256_srli_epi16(_mm256_mullo_epi16(blink_alpha_avx2(s), ca), 8);
+    __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(0xff), sa);
+    __m256i t = _mm256_mulhi_epu16(_mm256_mullo_epi16(s, clr), sa);
+    return _mm256_add_epi16(t, _mm256_srli_epi16(_mm256_mullo_epi16(d, ia), 8));
+}
+
+BLINK_AVX2 static void blink_fill_avx2(blink_Color *d, int n, blink_Color c) {
+    __m256i v = _mm256_set1_epi32(c.w);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_si256((__m256i*) (d + i), v);
+        _mm256_storeu_si256((__m256i*) (d + i + 8), v);
+    }
+    for (; i < n; i++) { d[i] = c; }
+}
+
+BLINK_AVX2 static void blink_blend_avx2(blink_Color *d, int n, blink_Color c) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i amask = _mm256_set1_epi32(0xff000000);
+    __m256i s = _mm256_unpacklo_epi8(_mm256_set1_epi32(c.w), zero);
+    __m256i a = _mm256_set1_epi16(c.a);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((__m256i*) (d + i));
+        __m256i lo = blink_lerp_avx2(_mm256_unpacklo_epi8(v, zero), s, a);
+        __m256i hi = blink_lerp_avx2(_mm256_unpackhi_epi8(v, zero), s, a);
+        __m256i r = _mm256_packus_epi16(lo, hi);
+        r = _mm256_or_si256(_mm256_andnot_si256(amask, r), _mm256_and_si256(v, amask));
+        _mm256_storeu_si256((__m256i*) (d + i), r);
+    }
+    for (; i < n; i++) { d[i] = blink_blend_pixel(d[i], c); }
+}
+
+BLINK_AVX2 static void blink_blit_avx2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i amask = _mm256_set1_epi32(0xff000000);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i sv = _mm256_loadu_si256((__m256i*) (s + i));
+        __m256i sa = _mm256_and_si256(sv, amask);
+        __m256i opaque = _mm256_cmpeq_epi32(sa, amask);
+        int m = _mm256_movemask_epi8(opaque);
+        if (m == -1) {
+            _mm256_storeu_si256((__m256i*) (d + i), sv);
+            continue;
+        }
+        if (m == 0 && _mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) == -1) { continue; }
+        __m256i v = _mm256_loadu_si256((__m256i*) (d + i));
+        __m256i slo = _mm256_unpacklo_epi8(sv, zero);
+        __m256i shi = _mm256_unpackhi_epi8(sv, zero);
+        __m256i lo = blink_lerp_avx2(_mm256_unpacklo_epi8(v, zero), slo, blink_alpha_avx2(slo));
+        __m256i hi = blink_lerp_avx2(_mm256_unpackhi_epi8(v, zero), shi, blink_alpha_avx2(shi));
+        __m256i r = _mm256_packus_epi16(lo, hi);
+        r = _mm256_or_si256(_mm256_andnot_si256(amask, r), _mm256_and_si256(v, amask));
+        r = _mm256_blendv_epi8(r, sv, opaque);
+        _mm256_storeu_si256((__m256i*) (d + i), r);
+    }
+    for (; i < n; i++) { d[i] = blink_blend_pixel(d[i], s[i]); }
+}
+
+BLINK_AVX2 static inline void blink_blit_mul_avx2_(blink_Color *d, const blink_Color *s, int n, blink_Color mul, __m256i add) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i amask = _mm256_set1_epi32(0xff000000);
+    __m256i clr = _mm256_unpacklo_epi8(_mm256_set1_epi32(mul.w), zero);
+    __m256i ca = _mm256_set1_epi16(mul.a);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i sv = _mm256_loadu_si256((__m256i*) (s + i));
+        __m256i v = _mm256_loadu_si256((__m256i*) (d + i));
+        __m256i slo = _mm256_unpacklo_epi8(sv, zero);
+        __m256i shi = _mm256_unpackhi_epi8(sv, zero);
+        __m256i sa = _mm256_packus_epi16(
+            _mm256_srli_epi16(_mm256_mullo_epi16(blink_alpha_avx2(slo), ca), 8),
+            _mm256_srli_epi16(_mm256_mullo_epi16(blink_alpha_avx2(shi), ca), 8));
+        __m256i keep = _mm256_cmpeq_epi32(_mm256_and_si256(sa, amask), zero);
+        if (_mm256_movemask_epi8(keep) == -1) { continue; }
+        sv = _mm256_adds_epu8(sv, add);
+        __m256i lo = blink_mul_avx2(_mm256_unpacklo_epi8(v, zero), _mm256_unpacklo_epi8(sv, zero), clr, ca);
+        __m256i hi = blink_mul_avx2(_mm256_unpackhi_epi8(v, zero), _mm256_unpackhi_epi8(sv, zero), clr, ca);
+        __m256i r = _mm256_packus_epi16(lo, hi);
+        r = _mm256_or_si256(_mm256_andnot_si256(amask, r), _mm256_and_si256(v, amask));
+        r = _mm256_blendv_epi8(r, v, keep);
+        _mm256_storeu_si256((__m256i*) (d + i), r);
+    }
+    blink_Color a = { .w = _mm256_cvtsi256_si32(add) };
+    for (; i < n; i++) { d[i] = blink_blend_pixel3(d[i], s[i], mul, a); }
+}
+
+BLINK_AVX2 static void blink_blit_mul_avx2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_mul_avx2_(d, s, n, mul, _mm256_setzero_si256());
+}
+
+BLINK_AVX2 static void blink_blit_mul_add_avx2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_mul_avx2_(d, s, n, mul, _mm256_set1_epi32(add.w & 0xffffff));
+}
+
+BLINK_AVX2 static void blink_gather_avx2(blink_Color *d, const blink_Color *row, int n, int sx, int step) {
+    __m256i x = _mm256_add_epi32(_mm256_set1_epi32(sx),
+        _mm256_mullo_epi32(_mm256_set1_epi32(step), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    __m256i inc = _mm256_set1_epi32(step * 8);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_srai_epi32(x, 10);
+        _mm256_storeu_si256((__m256i*) (d + i), _mm256_i32gather_epi32((const int*) row, idx, 4));
+        x = _mm256_add_epi32(x, inc);
+    }
+    blink_gather_scalar(d + i, row, n - i, sx + i * step, step);
+}
+BLINK_AVX2 static inline __m256i blink_div255_avx2(__m256i x) {
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+BLINK_AVX2 static inline __m256i blink_premul_avx2(__m256i d, __m256i s, __m256i k, __m256i add, bool mul, bool addc) {
+    if (addc) {
+        __m256i a = blink_alpha_avx2(s);
+        s = _mm256_min_epi16(_mm256_add_epi16(s, blink_div255_avx2(_mm256_mullo_epi16(add, a))), a);
+    }
+    if (mul) { s = blink_div255_avx2(_mm256_mullo_epi16(s, k)); }
+    __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(0xff), blink_alpha_avx2(s));
+    return _mm256_add_epi16(s, blink_div255_avx2(_mm256_mullo_epi16(d, ia)));
+}
+
+BLINK_AVX2 static inline void blink_blit_pm_avx2_(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add, bool usemul, bool useadd) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i amask = _mm256_set1_epi32(0xff000000);
+    blink_Color k = blink_premul_color(mul);
+    add.a = 0;
+    __m256i k16 = _mm256_unpacklo_epi8(_mm256_set1_epi32(k.w), zero);
+    __m256i add16 = _mm256_unpacklo_epi8(_mm256_set1_epi32(add.w), zero);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i sv = _mm256_loadu_si256((__m256i*) (s + i));
+        __m256i sa = _mm256_and_si256(sv, amask);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(useadd ? sa : sv, zero)) == -1) { continue; }
+        if (!usemul && !useadd && _mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, amask)) == -1) {
+            _mm256_storeu_si256((__m256i*) (d + i), sv);
+            continue;
+        }
+        __m256i v = _mm256_loadu_si256((__m256i*) (d + i));
+        __m256i lo = blink_premul_avx2(_mm256_unpacklo_epi8(v, zero), _mm256_unpacklo_epi8(sv, zero), k16, add16, usemul, useadd);
+        __m256i hi = blink_premul_avx2(_mm256_unpackhi_epi8(v, zero), _mm256_unpackhi_epi8(sv, zero), k16, add16, usemul, useadd);
+        _mm256_storeu_si256((__m256i*) (d + i), _mm256_packus_epi16(lo, hi));
+    }
+    blink_blit_pm_tail(d + i, s + i, n - i, k, add, usemul, useadd);
+}
+
+BLINK_AVX2 static void blink_blit_pm_avx2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_pm_avx2_(d, s, n, BLINK_WHITE, BLINK_BLACK, false, false);
+}
+
+BLINK_AVX2 static void blink_blit_pm_mul_avx2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_pm_avx2_(d, s, n, mul, BLINK_BLACK, true, false);
+}
+
+BLINK_AVX2 static void blink_blit_pm_mul_add_avx2(blink_Color *d, const blink_Color *s, int n, blink_Color mul, blink_Color add) {
+    blink_blit_pm_avx2_(d, s, n, mul, add, true, true);
+}
+BLINK_AVX2 static inline void blink_expand_mask_avx2(const uint8_t *m, __m256i *lo, __m256i *hi) {
+    __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) m));
+    v = _mm256_or_si256(v, _mm256_slli_epi32(v, 16));
+    *lo = _mm256_unpacklo_epi32(v, v);
+    *hi = _mm256_unpackhi_epi32(v, v);
+}
+
+BLINK_AVX2 static void blink_mask_avx2(blink_Color *d, const uint8_t *m, int n, blink_Color c) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i amask = _mm256_set1_epi32(0xff000000);
+    __m256i s = _mm256_unpacklo_epi8(_mm256_set1_epi32(c.w), zero);
+    __m256i opaque_color = _mm256_set1_epi32(c.w | 0xff000000);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int64_t w;
+        memcpy(&w, m + i, 8);
+        if (w == 0) { continue; }
+        if (w == -1) {
+            _mm256_storeu_si256((__m256i*) (d + i), opaque_color);
+            continue;
+        }
+        __m256i alo, ahi;
+        blink_expand_mask_avx2(m + i, &alo, &ahi);
+        __m256i v = _mm256_loadu_si256((__m256i*) (d + i));
+        __m256i lo = blink_lerp_avx2(_mm256_unpacklo_epi8(v, zero), s, alo);
+        __m256i hi = blink_lerp_avx2(_mm256_unpackhi_epi8(v, zero), s, ahi);
+        __m256i r = _mm256_packus_epi16(lo, hi);
+        r = _mm256_or_si256(_mm256_andnot_si256(amask, r), _mm256_and_si256(v, amask));
+        __m256i opaque = _mm256_cmpeq_epi32(_mm256_packus_epi16(alo, ahi), _mm256_set1_epi32(-1));
+        r = _mm256_blendv_epi8(r, opaque_color, opaque);
+        _mm256_storeu_si256((__m256i*) (d + i), r);
+    }
+    blink_mask_scalar(d + i, m + i, n - i, c);
+}
+
+BLINK_AVX2 static void blink_mask_mul_avx2(blink_Color *d, const uint8_t *m, int n, blink_Color c) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i amask = _mm256_set1_epi32(0xff000000);
+    __m256i cw = _mm256_mullo_epi16(_mm256_unpacklo_epi8(_mm256_set1_epi32(c.w), zero), _mm256_set1_epi16(0xff));
+    __m256i ca = _mm256_set1_epi16(c.a);
+    __m256i full = _mm256_set1_epi16(0xff);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int64_t w;
+        memcpy(&w, m + i, 8);
+        if (w == 0) { continue; }
+        __m256i alo, ahi;
+        blink_expand_mask_avx2(m + i, &alo, &ahi);
+        alo = _mm256_srli_epi16(_mm256_mullo_epi16(alo, ca), 8);
+        ahi = _mm256_srli_epi16(_mm256_mullo_epi16(ahi, ca), 8);
+        __m256i v = _mm256_loadu_si256((__m256i*) (d + i));
+        __m256i dlo = _mm256_unpacklo_epi8(v, zero);
+        __m256i dhi = _mm256_unpackhi_epi8(v, zero);
+        __m256i lo = _mm256_add_epi16(_mm256_mulhi_epu16(cw, alo), _mm256_srli_epi16(_mm256_mullo_epi16(dlo, _mm256_sub_epi16(full, alo)), 8));
+        __m256i hi = _mm256_add_epi16(_mm256_mulhi_epu16(cw, ahi), _mm256_srli_epi16(_mm256_mullo_epi16(dhi, _mm256_sub_epi16(full, ahi)), 8));
+        __m256i r = _mm256_packus_epi16(lo, hi);
+        r = _mm256_or_si256(_mm256_andnot_si256(amask, r), _mm256_and_si256(v, amask));
+        __m256i keep = _mm256_cmpeq_epi32(_mm256_packus_epi16(alo, ahi), zero);
+        r = _mm256_blendv_epi8(r, v, keep);
+        _mm256_storeu_si256((__m256i*) (d + i), r);
+    }
+    blink_mask_mul_scalar(d + i, m + i, n - i, c);
+}
+
+BLINK_AVX2 static void blink_mix_mono_avx2(float *d, const float *s, int n, float l, float r) {
+    __m256 g = _mm256_setr_ps(l, r, l, r, l, r, l, r);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(s + i);
+        __m256 lo = _mm256_unpacklo_ps(v, v), hi = _mm256_unpackhi_ps(v, v);
+        float *p = d + i * 2;
+        _mm256_storeu_ps(p, _mm256_add_ps(_mm256_loadu_ps(p), _mm256_mul_ps(_mm256_permute2f128_ps(lo, hi, 0x20), g)));
+        _mm256_storeu_ps(p + 8, _mm256_add_ps(_mm256_loadu_ps(p + 8), _mm256_mul_ps(_mm256_permute2f128_ps(lo, hi, 0x31), g)));
+    }
+    blink_mix_mono_scalar(d + i * 2, s + i, n - i, l, r);
+}
+
+BLINK_AVX2 static void blink_mix_stereo_avx2(float *d, const float *s, int n, float l, float r) {
+    __m256 g = _mm256_setr_ps(l, r, l, r, l, r, l, r);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float *p = d + i * 2;
+        _mm256_storeu_ps(p, _mm256_add_ps(_mm256_loadu_ps(p), _mm256_mul_ps(_mm256_loadu_ps(s + i * 2), g)));
+    }
+    blink_mix_stereo_scalar(d + i * 2, s + i * 2, n - i, l, r);
+}
+#endif
+
+static void blink_init_kernels(void) {
+    blink_kernels.fill = blink_fill_scalar;
+    blink_kernels.blend = blink_blend_scalar;
+    blink_kernels.blit = blink_blit_scalar;
+    blink_kernels.blit_mul = blink_blit_mul_scalar;
+    blink_kernels.blit_mul_add = blink_blit_mul_add_scalar;
+    blink_kernels.blit_pm = blink_blit_pm_scalar;
+    blink_kernels.blit_pm_mul = blink_blit_pm_mul_scalar;
+    blink_kernels.blit_pm_mul_add = blink_blit_pm_mul_add_scalar;
+    blink_kernels.mask = blink_mask_scalar;
+    blink_kernels.mask_mul = blink_mask_mul_scalar;
+    blink_kernels.gather = blink_gather_scalar;
+    blink_kernels.mix_mono = blink_mix_mono_scalar;
+    blink_kernels.mix_stereo = blink_mix_stereo_scalar;
+#ifdef BLINK_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        blink_kernels.fill = blink_fill_sse2;
+        blink_kernels.blend = blink_blend_sse2;
+        blink_kernels.blit = blink_blit_sse2;
+        blink_kernels.blit_mul = blink_blit_mul_sse2;
+        blink_kernels.blit_mul_add = blink_blit_mul_add_sse2;
+        blink_kernels.blit_pm = blink_blit_pm_sse2;
+        blink_kernels.blit_pm_mul = blink_blit_pm_mul_sse2;
+        blink_kernels.blit_pm_mul_add = blink_blit_pm_mul_add_sse2;
+        blink_kernels.mask = blink_mask_sse2;
+        blink_kernels.mask_mul = blink_mask_mul_sse2;
+        blink_kernels.mix_mono = blink_mix_mono_sse2;
+        blink_kernels.mix_stereo = blink_mix_stereo_sse2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        blink_kernels.fill = blink_fill_avx2;
+        blink_kernels.blend = blink_blend_avx2;
+        blink_kernels.blit = blink_blit_avx2;
+        blink_kernels.blit_mul = blink_blit_mul_avx2;
+        blink_kernels.blit_mul_add = blink_blit_mul_add_avx2;
+        blink_kernels.blit_pm = blink_blit_pm_avx2;
+        blink_kernels.blit_pm_mul = blink_blit_pm_mul_avx2;
+        blink_kernels.blit_pm_mul_add = blink_blit_pm_mul_add_avx2;
+        blink_kernels.mask = blink_mask_avx2;
+        blink_kernels.mask_mul = blink_mask_mul_avx2;
+        blink_kernels.gather = blink_gather_avx2;
+        blink_kernels.mix_mono = blink_mix_mono_avx2;
+        blink_kernels.mix_stereo = blink_mix_stereo_avx2;
     }
+#endif
+}
+
+#ifdef _WIN32
+typedef HANDLE blink_Thread;
+typedef CRITICAL_SECTION blink_Mutex;
+typedef CONDITION_VARIABLE blink_Cond;
+#else
+typedef pthread_t blink_Thread;
+typedef pthread_mutex_t blink_Mutex;
+typedef pthread_cond_t blink_Cond;
+#endif
+
+typedef struct { void (*fn)(void*); void *arg; } blink_ThreadStart;
+
+#ifdef _WIN32
+static DWORD WINAPI blink_thread_main(LPVOID p) {
+    blink_ThreadStart s = *(blink_ThreadStart*) p;
+    free(p);
+    s.fn(s.arg);
     return 0;
 }
 
-bool blink_key_down(blink_Context *ctx, int key) {
-    return blink_check_input_flag(ctx->key_state, key, sizeof(ctx->key_state), BLINK_INPUT_DOWN);
+static blink_Thread blink_create_thread(void (*fn)(void*), void *arg) {
+    blink_ThreadStart *s = blink_alloc(sizeof(*s));
+    *s = (blink_ThreadStart) { fn, arg };
+    blink_Thread t = CreateThread(NULL, 0, blink_thread_main, s, 0, NULL);
+    if (!t) { blink_panic("failed to create thread"); }
+    return t;
 }
 
-bool blink_key_pressed(blink_Context *ctx, int key) {
-    return blink_check_input_flag(ctx->key_state, key, sizeof(ctx->key_state), BLINK_INPUT_PRESSED);
+static void blink_join_thread(blink_Thread t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
 }
 
-bool blink_key_released(blink_Context *ctx, int key) {
-    return blink_check_input_flag(ctx->key_state, key, sizeof(ctx->key_state), BLINK_INPUT_RELEASED);
+static void blink_mutex_init(blink_Mutex *m) { InitializeCriticalSection(m); }
+static void blink_mutex_destroy(blink_Mutex *m) { DeleteCriticalSection(m); }
+static void blink_mutex_lock(blink_Mutex *m) { EnterCriticalSection(m); }
+static void blink_mutex_unlock(blink_Mutex *m) { LeaveCriticalSection(m); }
+static void blink_cond_init(blink_Cond *c) { InitializeConditionVariable(c); }
+static void blink_cond_destroy(blink_Cond *c) {}
+static void blink_cond_wait(blink_Cond *c, blink_Mutex *m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void blink_cond_signal(blink_Cond *c) { WakeConditionVariable(c); }
+static void blink_cond_broadcast(blink_Cond *c) { WakeAllConditionVariable(c); }
+
+static int blink_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+}
+#else
+static void *blink_thread_main(void *p) {
+    blink_ThreadStart s = *(blink_ThreadStart*) p;
+    free(p);
+    s.fn(s.arg);
+    return NULL;
 }
 
-void blink_mouse_pos(blink_Context *ctx, int *x, int *y) {
-    if (x) { *x = ctx->mouse_pos.x; }
-    if (y) { *y = ctx->mouse_pos.y; }
+static blink_Thread blink_create_thread(void (*fn)(void*), void *arg) {
+    blink_ThreadStart *s = blink_alloc(sizeof(*s));
+    *s = (blink_ThreadStart) { fn, arg };
+    blink_Thread t;
+    if (pthread_create(&t, NULL, blink_thread_main, s)) { blink_panic("failed to create thread"); }
+    return t;
 }
 
-void blink_mouse_delta(blink_Context *ctx, int *x, int *y) {
-    if (x) { *x = ctx->mouse_delta.x; }
-    if (y) { *y = ctx->mouse_delta.y; }
+static void blink_join_thread(blink_Thread t) {
+    pthread_join(t, NULL);
 }
 
-bool blink_mouse_down(blink_Context *ctx, int button) {
-    return blink_check_input_flag(ctx->mouse_state, button, sizeof(ctx->mouse_state), BLINK_INPUT_DOWN);
+static void blink_mutex_init(blink_Mutex *m) { pthread_mutex_init(m, NULL); }
+static void blink_mutex_destroy(blink_Mutex *m) { pthread_mutex_destroy(m); }
+static void blink_mutex_lock(blink_Mutex *m) { pthread_mutex_lock(m); }
+static void blink_mutex_unlock(blink_Mutex *m) { pthread_mutex_unlock(m); }
+static void blink_cond_init(blink_Cond *c) { pthread_cond_init(c, NULL); }
+static void blink_cond_destroy(blink_Cond *c) { pthread_cond_destroy(c); }
+static void blink_cond_wait(blink_Cond *c, blink_Mutex *m) { pthread_cond_wait(c, m); }
+static void blink_cond_signal(blink_Cond *c) { pthread_cond_signal(c); }
+static void blink_cond_broadcast(blink_Cond *c) { pthread_cond_broadcast(c); }
+
+static int blink_cpu_count(void) {
+    return blink_max(1, (int) sysconf(_SC_NPROCESSORS_ONLN));
 }
+#endif
 
-bool blink_mouse_pressed(blink_Context *ctx, int button) {
-    return blink_check_input_flag(ctx->mouse_state, button, sizeof(ctx->mouse_state), BLINK_INPUT_PRESSED);
+typedef struct {
+    void *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+} blink_Mapping;
+
+#ifdef _WIN32
+static bool blink_map_file(const char *filename, blink_Mapping *m) {
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    m->mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!m->mapping) { return false; }
+    m->data = MapViewOfFile(m->mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!m->data) {
+        CloseHandle(m->mapping);
+        return false;
+    }
+    m->size = size.QuadPart;
+    return true;
 }
 
-bool blink_mouse_released(blink_Context *ctx, int button) {
-    return blink_check_input_flag(ctx->mouse_state, button, sizeof(ctx->mouse_state), BLINK_INPUT_RELEASED);
+static void blink_unmap_file(blink_Mapping *m) {
+    UnmapViewOfFile(m->data);
+    CloseHandle(m->mapping);
+}
+#else
+static bool blink_map_file(const char *filename, blink_Mapping *m) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    m->data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m->data == MAP_FAILED) { return false; }
+    m->size = st.st_size;
+    return true;
 }
 
-float blink_mouse_scroll(blink_Context *ctx) {
-    return ctx->mouse_scroll;
+static void blink_unmap_file(blink_Mapping *m) {
+    munmap(m->data, m->size);
 }
+#endif
 
-void blink_clear(blink_Context *ctx, blink_Color color) {
-    blink_draw_rect(ctx, blink_rect(0, 0, 0xffffff, 0xffffff), color);
+typedef struct {
+    void (*fn)(void *arg, int index);
+    void *arg;
+    int index;
+} blink_Task;
+
+struct blink_Pool {
+    blink_Mutex lock;
+    blink_Cond wake, idle;
+    blink_Thread *threads;
+    int thread_count;
+    blink_Task *tasks;
+    int head, count, cap;
+    int pending;
+    bool quit;
+};
+
+static bool blink_pool_pop(blink_Pool *pool, blink_Task *task) {
+    if (!pool->count) { return false; }
+    *task = pool->tasks[pool->head];
+    pool->head = (pool->head + 1) % pool->cap;
+    pool->count--;
+    return true;
 }
 
-void blink_set_clip(blink_Context *ctx, blink_Rect rect) {
-    blink_Rect screen_rect = blink_rect(0, 0, ctx->screen->w, ctx->screen->h);
-    ctx->clip = blink_intersect_rects(rect, screen_rect);
+static void blink_pool_finish(blink_Pool *pool) {
+    if (--pool->pending == 0) { blink_cond_broadcast(&pool->idle); }
 }
 
-void blink_draw_point(blink_Context *ctx, int x, int y, blink_Color color) {
-    if (color.a == 0) { return; }
-    blink_Rect r = ctx->clip;
+static void blink_pool_main(void *arg) {
+    blink_Pool *pool = arg;
+    blink_mutex_lock(&pool->lock);
+    for (;;) {
+        blink_Task task;
+        while (!pool->quit && !blink_pool_pop(pool, &task)) {
+            blink_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->quit) { break; }
+        blink_mutex_unlock(&pool->lock);
+        task.fn(task.arg, task.index);
+        blink_mutex_lock(&pool->lock);
+        blink_pool_finish(pool);
+    }
+    blink_mutex_unlock(&pool->lock);
+}
+
+static blink_Pool *blink_create_pool(int thread_count) {
+    blink_Pool *pool = blink_alloc(sizeof(blink_Pool));
+    blink_mutex_init(&pool->lock);
+    blink_cond_init(&pool->wake);
+    blink_cond_init(&pool->idle);
+    pool->thread_count = thread_count;
+    pool->threads = blink_alloc(sizeof(blink_Thread) * blink_max(1, thread_count));
+    for (int i = 0; i < thread_count; i++) {
+        pool->threads[i] = blink_create_thread(blink_pool_main, pool);
+    }
+    return pool;
+}
+
+static void blink_destroy_pool(blink_Pool *pool) {
+    if (!pool) { return; }
+    blink_mutex_lock(&pool->lock);
+    pool->quit = true;
+    blink_cond_broadcast(&pool->wake);
+    blink_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->thread_count; i++) {
+        blink_join_thread(pool->threads[i]);
+    }
+    blink_cond_destroy(&pool->wake);
+    blink_cond_destroy(&pool->idle);
+    blink_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->tasks);
+    free(pool);
+}
+
+static void blink_pool_push(blink_Pool *pool, void (*fn)(void*, int), void *arg, int index) {
+    blink_mutex_lock(&pool->lock);
+    if (pool->count == pool->cap) {
+        int cap = blink_max(64, pool->cap * 2);
+        blink_Task *tasks = blink_alloc(sizeof(blink_Task) * cap);
+        for (int i = 0; i < pool->count; i++) {
+            tasks[i] = pool->tasks[(pool->head + i) % pool->cap];
+        }
+        free(pool->tasks);
+        pool->tasks = tasks;
+        pool->cap = cap;
+        pool->head = 0;
+    }
+    pool->tasks[(pool->head + pool->count) % pool->cap] = (blink_Task) { fn, arg, index };
+    pool->count++;
+    pool->pending++;
+    blink_cond_signal(&pool->wake);
+    blink_mutex_unlock(&pool->lock);
+}
+
+static void blink_pool_wait(blink_Pool *pool) {
+    blink_mutex_lock(&pool->lock);
+    blink_Task task;
+    while (blink_pool_pop(pool, &task)) {
+        blink_mutex_unlock(&pool->lock);
+        task.fn(task.arg, task.index);
+        blink_mutex_lock(&pool->lock);
+        blink_pool_finish(pool);
+    }
+    while (pool->pending) {
+        blink_cond_wait(&pool->idle, &pool->lock);
+    }
+    blink_mutex_unlock(&pool->lock);
+}
+
+enum {
+    BLINK_SPAN_SKIP,
+    BLINK_SPAN_COPY,
+    BLINK_SPAN_BLEND
+};
+
+#define BLINK_SPAN_MIN 8
+
+struct blink_Spans {
+    int *rows;
+    uint32_t *runs;
+};
+
+/* premultiplied pixels with a == 0 but rgb > 0 are additive, only all-zero ones can be skipped */
+static int blink_span_kind(blink_Color c, bool premul) {
+    if (premul ? c.w == 0 : c.a == 0) { return BLINK_SPAN_SKIP; }
+    return c.a == 0xff ? BLINK_SPAN_COPY : BLINK_SPAN_BLEND;
+}
+
+static void blink_blit_spans(blink_Stats *st, blink_Color *d, const blink_Color *srow, const uint32_t *run, int x, int n, blink_BlitFn blit, bool copy, blink_Color mul, blink_Color add) {
+    int pos = 0, end = x + n;
+    while (pos < end) {
+        int len = *run >> 2, kind = *run & 3;
+        run++;
+        int a = blink_max(pos, x), b = blink_min(pos + len, end);
+        pos += len;
+        if (a >= b || kind == BLINK_SPAN_SKIP) { continue; }
+        if (kind == BLINK_SPAN_COPY && copy) {
+            memcpy(d + (a - x), srow + a, (b - a) * sizeof(blink_Color));
+            st->copied += b - a;
+        } else {
+            blit(d + (a - x), srow + a, b - a, mul, add);
+            st->blended += b - a;
+        }
+        st->touched += b - a;
+    }
+}
+
+typedef struct {
+    blink_Image *image;
+    blink_Rect clip;
+    blink_Stats *stats;
+} blink_Target;
+
+static void blink_count_pixels(blink_Stats *st, int64_t n, bool copy) {
+    st->touched += n;
+    if (copy) {
+        st->copied += n;
+    } else {
+        st->blended += n;
+    }
+}
+
+static void blink_raster_point(blink_Target *t, int x, int y, blink_Color color) {
+    blink_Rect r = t->clip;
     if (x < r.x || y < r.y || x >= r.x + r.w || y >= r.y + r.h ) { return; }
-    blink_Color *dst = &ctx->screen->pixels[x + y * ctx->screen->w];
+    blink_Color *dst = &t->image->pixels[x + y * t->image->w];
     *dst = blink_blend_pixel(*dst, color);
+    blink_count_pixels(t->stats, 1, color.a == 0xff);
 }
 
-void blink_draw_rect(blink_Context *ctx, blink_Rect rect, blink_Color color) {
-    if (color.a == 0) { return; }
-    rect = blink_intersect_rects(rect, ctx->clip);
-    blink_Color *d = &ctx->screen->pixels[rect.x + rect.y * ctx->screen->w];
-    int dr = ctx->screen->w - rect.w;
+static void blink_raster_rect(blink_Target *t, blink_Rect rect, blink_Color color) {
+    rect = blink_intersect_rects(rect, t->clip);
+    if (rect.w <= 0 || rect.h <= 0) { return; }
+    blink_count_pixels(t->stats, (int64_t) rect.w * rect.h, color.a == 0xff);
+    blink_SpanFn span = color.a == 0xff ? blink_kernels.fill : blink_kernels.blend;
+    int w = t->image->w;
+    blink_Color *d = &t->image->pixels[rect.x + rect.y * w];
+    if (rect.w == w) {
+        span(d, rect.w * rect.h, color);
+        return;
+    }
     for (int y = 0; y < rect.h; y++) {
-        for (int x = 0; x < rect.w; x++) {
-            *d = blink_blend_pixel(*d, color);
-            d++;
-        }
-        d += dr;
+        span(d, rect.w, color);
+        d += w;
     }
 }
 
-void blink_draw_line(blink_Context *ctx, int x1, int y1, int x2, int y2, blink_Color color) {
+static void blink_raster_line(blink_Target *t, int x1, int y1, int x2, int y2, blink_Color color) {
     int dx = abs(x2-x1);
     int sx = x1 < x2 ? 1 : -1;
     int dy = -abs(y2 - y1);
     int sy = y1 < y2 ? 1 : -1;
     int err = dx + dy;
     for (;;) {
-        blink_draw_point(ctx, x1, y1, color);
+        blink_raster_point(t, x1, y1, color);
         if (x1 == x2 && y1 == y2) { break; }
         int e2 = err << 1;
         if (e2 >= dy) { err += dy; x1 += sx; }
@@ -495,74 +1144,3112 @@ void blink_draw_line(blink_Context *ctx, int x1, int y1, int x2, int y2, blink_C
     }
 }
 
-void blink_draw_image(blink_Context *ctx, blink_Image *img, int x, int y) {
-    blink_Rect dst = blink_rect(x, y, img->w, img->h);
-    blink_Rect src = blink_rect(0, 0, img->w, img->h);
-    blink_draw_image3(ctx, img, dst, src, BLINK_WHITE, BLINK_BLACK);
-}
-
-void blink_draw_image2(blink_Context *ctx, blink_Image *img, int x, int y, blink_Rect src, blink_Color color) {
-    blink_Rect dst = blink_rect(x, y, abs(src.w), abs(src.h));
-    blink_draw_image3(ctx, img, dst, src, color, BLINK_BLACK);
-}
-
-void blink_draw_image3(blink_Context *ctx, blink_Image *img, blink_Rect dst, blink_Rect src, blink_Color mul_color, blink_Color add_color) {
-    if (!src.w || !src.w || !dst.w || !dst.h) { return; }
+static void blink_raster_image(blink_Target *t, blink_Image *img, blink_Rect dst, blink_Rect src, blink_Color mul_color, blink_Color add_color) {
+    if (!src.w || !src.h || !dst.w || !dst.h) { return; }
 
-    int cx1 = ctx->clip.x;
-    int cy1 = ctx->clip.y;
-    int cx2 = cx1 + ctx->clip.w;
-    int cy2 = cy1 + ctx->clip.h;
+    int cx1 = t->clip.x;
+    int cy1 = t->clip.y;
+    int cx2 = cx1 + t->clip.w;
+    int cy2 = cy1 + t->clip.h;
     int stepx = (src.w << 10) / dst.w;
     int stepy = (src.h << 10) / dst.h;
+    int sx = src.x << 10;
     int sy = src.y << 10;
 
     int dy = dst.y;
     if (dy < cy1) { sy += (cy1 - dy) * stepy; dy = cy1; }
     int ey = blink_min(cy2, dst.y + dst.h);
 
-    int blend_fn = 1;
-    if (mul_color.w != 0xffffffff) { blend_fn = 2; }
-    if ((add_color.w & 0xffffff00) != 0xffffff00) { blend_fn = 3; }
+    int dx = dst.x;
+    if (dx < cx1) { sx += (cx1 - dx) * stepx; dx = cx1; }
+    int ex = blink_min(cx2, dst.x + dst.w);
+    int n = ex - dx;
+    if (n <= 0) { return; }
 
-    for (; dy < ey; dy++) {
-        if (dy >= cy1 && dy < cy2) {
-            int sx = src.x << 10;
+    blink_BlitFn blit = blink_kernels.blit;
+    if (mul_color.w != 0xffffffff) { blit = blink_kernels.blit_mul; }
+    if (add_color.w & 0xffffff) { blit = blink_kernels.blit_mul_add; }
+    if (img->flags & BLINK_IMAGE_PREMULTIPLIED) {
+        blit = blink_kernels.blit_pm;
+        if (mul_color.w != 0xffffffff) { blit = blink_kernels.blit_pm_mul; }
+        if (add_color.w & 0xffffff) { blit = blink_kernels.blit_pm_mul_add; }
+    }
+
+    blink_Image *screen = t->image;
+    blink_Spans *spans = img->spans;
+    if (stepx == 1 << 10) {
+        bool copy = blit == blink_kernels.blit || blit == blink_kernels.blit_pm;
+        for (; dy < ey; dy++) {
             blink_Color *srow = &img->pixels[(sy >> 10) * img->w];
-            blink_Color *drow = &ctx->screen->pixels[dy * ctx->screen->w];
-
-            int dx = dst.x;
-            if (dx < cx1) { sx += (cx1 - dx) * stepx; dx = cx1; }
-            int ex = blink_min(cx2, dst.x + dst.w);
-
-            for (; dx < ex; dx++) {
-                blink_Color *s = &srow[sx >> 10];
-                blink_Color *d = &drow[dx];
-                switch (blend_fn) {
-                case 1: *d = blink_blend_pixel(*d, *s); break;
-                case 2: *d = blink_blend_pixel2(*d, *s, mul_color); break;
-                case 3: *d = blink_blend_pixel3(*d, *s, mul_color, add_color); break;
-                }
-                sx += stepx;
+            blink_Color *drow = &screen->pixels[dy * screen->w + dx];
+            if (spans) {
+                uint32_t *run = &spans->runs[spans->rows[sy >> 10]];
+                blink_blit_spans(t->stats, drow, srow, run, sx >> 10, n, blit, copy, mul_color, add_color);
+            } else {
+                blit(drow, srow + (sx >> 10), n, mul_color, add_color);
+                blink_count_pixels(t->stats, n, false);
+            }
+            sy += stepy;
+        }
+        return;
+    }
+
+    blink_Color buf[256];
+    for (; dy < ey; dy++) {
+        blink_Color *srow = &img->pixels[(sy >> 10) * img->w];
+        blink_Color *drow = &screen->pixels[dy * screen->w + dx];
+        if (spans) {
+            int *row = &spans->rows[sy >> 10];
+            if (row[1] - row[0] == 1 && (spans->runs[row[0]] & 3) == BLINK_SPAN_SKIP) {
+                sy += stepy;
+                continue;
             }
         }
+        for (int i = 0; i < n; i += blink_lengthof(buf)) {
+            int m = blink_min((int) blink_lengthof(buf), n - i);
+            blink_kernels.gather(buf, srow, m, sx + i * stepx, stepx);
+            blit(drow + i, buf, m, mul_color, add_color);
+        }
+        blink_count_pixels(t->stats, n, false);
         sy += stepy;
     }
 }
 
-int blink_draw_text(blink_Context *ctx, const char *text, int x, int y, blink_Color color) {
-    return blink_draw_text2(ctx, ctx->font, text, x, y, color);
+static int blink_raster_glyphs(blink_Target *t, blink_Font *font, const char *text, int x, int y, blink_Color color) {
+    blink_Rect clip = t->clip;
+    int gh = font->image->h / 16;
+    int y1 = blink_max(y, clip.y) - y;
+    int y2 = blink_min(y + gh, clip.y + clip.h) - y;
+    int cx2 = clip.x + clip.w;
+    if (y1 >= y2 || color.a == 0) {
+        return x + blink_text_width(font, text);
+    }
+
+    blink_MaskFn mask = color.w == 0xffffffff ? blink_kernels.mask : blink_kernels.mask_mul;
+    int stride = font->image->w;
+    blink_Color *drow = &t->image->pixels[(y + y1) * t->image->w];
+    for (uint8_t *p = (void*) text; *p; p++) {
+        blink_Glyph *g = &font->glyphs[*p];
+        int x1 = blink_max(x, clip.x);
+        int x2 = blink_min(x + g->rect.w, cx2);
+        if (x1 < x2) {
+            const uint8_t *m = &font->coverage[(g->rect.y + y1) * stride + g->rect.x + (x1 - x)];
+            blink_Color *d = drow + x1;
+            for (int r = y1; r < y2; r++) {
+                mask(d, m, x2 - x1, color);
+                d += t->image->w;
+                m += stride;
+            }
+            blink_count_pixels(t->stats, (x2 - x1) * (y2 - y1), false);
+        }
+        x += g->xadv;
+    }
+    return x;
 }
 
-int blink_draw_text2(blink_Context *ctx, blink_Font *font, const char *text, int x, int y, blink_Color color) {
+static int blink_raster_text(blink_Target *t, blink_Font *font, const char *text, int x, int y, blink_Color color) {
+    if (font->coverage) {
+        return blink_raster_glyphs(t, font, text, x, y, color);
+    }
     for (uint8_t *p = (void*) text; *p; p++) {
         blink_Glyph g = font->glyphs[*p];
-        blink_draw_image2(ctx, font->image, x, y, g.rect, color);
+        blink_Rect dst = blink_rect(x, y, abs(g.rect.w), abs(g.rect.h));
+        blink_raster_image(t, font->image, dst, g.rect, color, BLINK_BLACK);
         x += g.xadv;
     }
     return x;
 }
 
+enum {
+    BLINK_COMMAND_RECT,
+    BLINK_COMMAND_LINE,
+    BLINK_COMMAND_IMAGE,
+    BLINK_COMMAND_TEXT
+};
+
+typedef struct {
+    int type;
+    int count;
+    int offset;
+    blink_Rect clip;
+    blink_Color color, add;
+    void *ptr;
+} blink_Command;
+
+typedef struct { blink_Rect dst, src; } blink_ImageItem;
+typedef struct { int x1, y1, x2, y2; } blink_LineItem;
+typedef struct { int x, y, len; } blink_TextItem;
+
+typedef struct { int command, offset; } blink_TileItem;
+
+struct blink_CommandBuffer {
+    blink_Command *commands;
+    int count, cap;
+    uint8_t *data;
+    int len, data_cap;
+    int *tile_start;
+    int tile_cap;
+    blink_TileItem *items;
+    int item_cap;
+    blink_Stats *tile_stats;
+    int stats_cap;
+};
+
+static void *blink_grow(void *p, int *cap, int need, int size) {
+    if (need <= *cap) { return p; }
+    int n = blink_max(need, *cap * 2);
+    n = blink_max(n, 64);
+    p = realloc(p, (size_t) n * size);
+    if (!p) { blink_panic("out of memory"); }
+    *cap = n;
+    return p;
+}
+
+static int blink_item_size(blink_Command *cmd, uint8_t *item) {
+    switch (cmd->type) {
+    case BLINK_COMMAND_RECT: return sizeof(blink_Rect);
+    case BLINK_COMMAND_LINE: return sizeof(blink_LineItem);
+    case BLINK_COMMAND_IMAGE: return sizeof(blink_ImageItem);
+    }
+    return (sizeof(blink_TextItem) + ((blink_TextItem*) item)->len + 4) & ~3;
+}
+
+static void *blink_push_command(blink_Context *ctx, int type, void *ptr, blink_Color color, blink_Color add, int size) {
+    blink_CommandBuffer *cb = ctx->commands;
+    blink_Command *cmd = cb->count ? &cb->commands[cb->count - 1] : NULL;
+    bool merge = cmd && cmd->type == type && cmd->ptr == ptr &&
+        cmd->color.w == color.w && cmd->add.w == add.w &&
+        !memcmp(&cmd->clip, &ctx->clip, sizeof(blink_Rect));
+
+    if (!merge) {
+        cb->commands = blink_grow(cb->commands, &cb->cap, cb->count + 1, sizeof(blink_Command));
+        cmd = &cb->commands[cb->count++];
+        *cmd = (blink_Command) { type, 0, cb->len, ctx->clip, color, add, ptr };
+    }
+
+    size = (size + 3) & ~3;
+    cb->data = blink_grow(cb->data, &cb->data_cap, cb->len + size, 1);
+    void *res = cb->data + cb->len;
+    cb->len += size;
+    cmd->count++;
+    return res;
+}
+
+static void blink_run_item(blink_Target *t, blink_Command *cmd, uint8_t *p) {
+    switch (cmd->type) {
+    case BLINK_COMMAND_RECT: {
+        blink_raster_rect(t, *(blink_Rect*) p, cmd->color);
+        break;
+    }
+    case BLINK_COMMAND_LINE: {
+        blink_LineItem *l = (void*) p;
+        blink_raster_line(t, l->x1, l->y1, l->x2, l->y2, cmd->color);
+        break;
+    }
+    case BLINK_COMMAND_IMAGE: {
+        blink_ImageItem *im = (void*) p;
+        blink_raster_image(t, cmd->ptr, im->dst, im->src, cmd->color, cmd->add);
+        break;
+    }
+    case BLINK_COMMAND_TEXT: {
+        blink_TextItem *tx = (void*) p;
+        blink_raster_text(t, cmd->ptr, (char*) (tx + 1), tx->x, tx->y, cmd->color);
+        break;
+    }
+    }
+}
+
+static blink_Rect blink_item_bounds(blink_Command *cmd, uint8_t *p) {
+    blink_Rect r = cmd->clip;
+    switch (cmd->type) {
+    case BLINK_COMMAND_RECT: {
+        r = *(blink_Rect*) p;
+        break;
+    }
+    case BLINK_COMMAND_LINE: {
+        blink_LineItem *l = (void*) p;
+        r = blink_rect(blink_min(l->x1, l->x2), blink_min(l->y1, l->y2), abs(l->x2 - l->x1) + 1, abs(l->y2 - l->y1) + 1);
+        break;
+    }
+    case BLINK_COMMAND_IMAGE: {
+        r = ((blink_ImageItem*) p)->dst;
+        break;
+    }
+    case BLINK_COMMAND_TEXT: {
+        blink_TextItem *tx = (void*) p;
+        blink_Font *font = cmd->ptr;
+        r = blink_rect(tx->x, tx->y, blink_text_width(font, (char*) (tx + 1)), font->image->h / 16);
+        break;
+    }
+    }
+    return blink_intersect_rects(r, cmd->clip);
+}
+
+typedef struct {
+    blink_Context *ctx;
+    int tiles_x, tiles_y;
+    int *tile_start;
+    blink_TileItem *items;
+    blink_Stats *stats;
+} blink_TileJob;
+
+static void blink_run_tile(void *arg, int index) {
+    blink_TileJob *job = arg;
+    blink_CommandBuffer *cb = job->ctx->commands;
+    blink_Image *screen = job->ctx->screen;
+    int tx = (index % job->tiles_x) * BLINK_TILE_SIZE;
+    int ty = (index / job->tiles_x) * BLINK_TILE_SIZE;
+    blink_Rect tile = blink_intersect_rects(
+        blink_rect(tx, ty, BLINK_TILE_SIZE, BLINK_TILE_SIZE),
+        blink_rect(0, 0, screen->w, screen->h));
+    blink_Target t = { screen, tile, &job->stats[index] };
+    for (int i = job->tile_start[index]; i < job->tile_start[index + 1]; i++) {
+        blink_Command *cmd = &cb->commands[job->items[i].command];
+        t.clip = blink_intersect_rects(cmd->clip, tile);
+        blink_run_item(&t, cmd, cb->data + job->items[i].offset);
+    }
+}
+
+static bool blink_is_culled(blink_Context *ctx, blink_Rect bounds) {
+    bounds = blink_intersect_rects(bounds, ctx->clip);
+    return bounds.w <= 0 || bounds.h <= 0;
+}
+
+static int64_t blink_clipped_area(blink_Context *ctx, blink_Rect r) {
+    blink_Rect c = blink_intersect_rects(r, ctx->clip);
+    int64_t area = (int64_t) r.w * r.h;
+    return c.w > 0 && c.h > 0 ? area - (int64_t) c.w * c.h : area;
+}
+
+static int blink_clipped_line(blink_Context *ctx, int x1, int y1, int x2, int y2) {
+    blink_Rect c = ctx->clip;
+    int dx = abs(x2 - x1);
+    int sx = x1 < x2 ? 1 : -1;
+    int dy = -abs(y2 - y1);
+    int sy = y1 < y2 ? 1 : -1;
+    int err = dx + dy;
+    int res = 0;
+    for (;;) {
+        if (x1 < c.x || y1 < c.y || x1 >= c.x + c.w || y1 >= c.y + c.h) { res++; }
+        if (x1 == x2 && y1 == y2) { break; }
+        int e2 = err << 1;
+        if (e2 >= dy) { err += dy; x1 += sx; }
+        if (e2 <= dx) { err += dx; y1 += sy; }
+    }
+    return res;
+}
+
+static blink_Rect blink_union_rects(blink_Rect a, blink_Rect b) {
+    int x1 = blink_min(a.x, b.x);
+    int y1 = blink_min(a.y, b.y);
+    int x2 = blink_max(a.x + a.w, b.x + b.w);
+    int y2 = blink_max(a.y + a.h, b.y + b.h);
+    return (blink_Rect) { x1, y1, x2 - x1, y2 - y1 };
+}
+
+static void blink_mark_dirty(blink_Context *ctx, blink_Rect r) {
+    r = blink_intersect_rects(r, ctx->clip);
+    if (r.w <= 0 || r.h <= 0) { return; }
+
+    int best = 0, best_growth = -1;
+    for (int i = 0; i < ctx->dirty_count; i++) {
+        blink_Rect d = ctx->dirty[i];
+        blink_Rect o = blink_intersect_rects(d, r);
+        if (o.w >= 0 && o.h >= 0) {
+            ctx->dirty[i] = blink_union_rects(d, r);
+            return;
+        }
+        blink_Rect u = blink_union_rects(d, r);
+        int growth = u.w * u.h - d.w * d.h;
+        if (best_growth < 0 || growth < best_growth) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+
+    if (ctx->dirty_count < blink_lengthof(ctx->dirty)) {
+        ctx->dirty[ctx->dirty_count++] = r;
+    } else {
+        ctx->dirty[best] = blink_union_rects(ctx->dirty[best], r);
+    }
+}
+
+static blink_Target blink_screen_target(blink_Context *ctx) {
+    return (blink_Target) { ctx->screen, ctx->clip, &ctx->stats };
+}
+
+static bool blink_check_column(blink_Image *img, int x, int y, int h) {
+    while (h > 0) {
+        if (img->pixels[x + y * img->w].a) { return true; }
+        y++; h--;
+    }
+    return false;
+}
+
+static blink_Font *blink_load_font_from_image(blink_Image *img) {
+    if (!img) { return NULL; }
+    blink_Font *font = blink_alloc(sizeof(blink_Font));
+    font->image = img;
+
+    for (int i = 0; i < 256; i++) {
+        blink_Glyph *g = &font->glyphs[i];
+        blink_Rect r = {
+            (img->w / 16) * (i % 16),
+            (img->h / 16) * (i / 16),
+            img->w / 16,
+            img->h / 16
+        };
+        for (int x = r.x + r.w - 1; x >= r.x; x--) {
+            if (blink_check_column(font->image, x, r.y, r.h)) { break; }
+            r.w--;
+        }
+        for (int x = r.x; x < r.x + r.w; x++) {
+            if (blink_check_column(font->image, x, r.y, r.h)) { break; }
+            r.x++;
+            r.w--;
+        }
+        g->xadv = r.w + 1;
+        g->rect = r;
+    }
+
+    font->glyphs[' '].rect = (blink_Rect) {0};
+    font->glyphs[' '].xadv = font->glyphs['a'].xadv;
+
+    font->coverage = blink_alloc(img->w * img->h);
+    for (int i = 0; i < img->w * img->h; i++) {
+        blink_Color c = img->pixels[i];
+        if (c.a && (c.w & 0xffffff) != 0xffffff) {
+            free(font->coverage);
+            font->coverage = NULL;
+            break;
+        }
+        font->coverage[i] = c.a;
+    }
+
+    return font;
+}
+
+#ifdef BLINK_WIN32
+static blink_Rect blink_get_adjusted_window_rect(blink_Context *ctx) {
+    float src_ar = (float) ctx->screen->h / ctx->screen->w;
+    float dst_ar = (float) ctx->height / ctx->width;
+    int w, h;
+    if (src_ar < dst_ar) {
+        w = ctx->width; h = ceil(w * src_ar);
+    } else {
+        h = ctx->height; w = ceil(h / src_ar);
+    }
+    return blink_rect((ctx->width - w) / 2, (ctx->height - h) / 2, w, h);
+}
+
+static void blink_present_rect(blink_Context *ctx, blink_Rect wr, blink_Rect r) {
+    int sw = ctx->screen->w;
+    int sh = ctx->screen->h;
+    BITMAPINFO bmi = {
+        .bmiHeader.biSize = sizeof(BITMAPINFOHEADER),
+        .bmiHeader.biBitCount = 32,
+        .bmiHeader.biCompression = BI_RGB,
+        .bmiHeader.biPlanes = 1,
+        .bmiHeader.biWidth = sw,
+        .bmiHeader.biHeight = -r.h
+    };
+
+    int x1 = wr.x + r.x * wr.w / sw;
+    int y1 = wr.y + r.y * wr.h / sh;
+    int x2 = wr.x + (r.x + r.w) * wr.w / sw;
+    int y2 = wr.y + (r.y + r.h) * wr.h / sh;
+
+    StretchDIBits(ctx->hdc,
+        x1, y1, x2 - x1, y2 - y1,
+        r.x, 0, r.w, r.h,
+        &ctx->screen->pixels[r.y * sw], &bmi, DIB_RGB_COLORS, SRCCOPY);
+}
+
+static LRESULT CALLBACK blink_wndproc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+    blink_Context *ctx = (void*) GetProp(hwnd, "blink_Context");
+
+    switch (message) {
+    case WM_PAINT:
+        blink_Rect wr = blink_get_adjusted_window_rect(ctx);
+        blink_present_rect(ctx, wr, blink_rect(0, 0, ctx->screen->w, ctx->screen->h));
+        ValidateRect(hwnd, 0);
+        break;
+
+    case WM_SETCURSOR:
+        if (ctx->hide_cursor && LOWORD(lparam) == HTCLIENT) {
+            SetCursor(0);
+            break;
+        }
+        goto unhandled;
+
+    case WM_KEYDOWN:
+    case WM_SYSKEYDOWN:
+        if (lparam & (1 << 30)) { break; }
+        ctx->key_state[(uint8_t) wparam] = BLINK_INPUT_DOWN | BLINK_INPUT_PRESSED;
+        break;
+
+    case WM_KEYUP:
+    case WM_SYSKEYUP:
+        ctx->key_state[(uint8_t) wparam] &= ~BLINK_INPUT_DOWN;
+        ctx->key_state[(uint8_t) wparam] |= BLINK_INPUT_RELEASED;
+        break;
+
+    case WM_CHAR:
+        if (wparam < 32) { break; }
+        for (int i = 0; i < blink_lengthof(ctx->char_buf); i++) {
+            if (ctx->char_buf[i]) { continue; }
+            ctx->char_buf[i] = wparam;
+            break;
+        }
+        break;
+
+    case WM_LBUTTONDOWN: case WM_LBUTTONUP:
+    case WM_RBUTTONDOWN: case WM_RBUTTONUP:
+    case WM_MBUTTONDOWN: case WM_MBUTTONUP:
+        int button = (message == WM_LBUTTONDOWN || message == WM_LBUTTONUP) ? 1 :
+                     (message == WM_RBUTTONDOWN || message == WM_RBUTTONUP) ? 2 : 3;
+        if (message == WM_LBUTTONDOWN || message == WM_RBUTTONDOWN || message == WM_MBUTTONDOWN) {
+            SetCapture(hwnd);
+            ctx->mouse_state[button] = BLINK_INPUT_DOWN | BLINK_INPUT_PRESSED;
+        } else {
+            ReleaseCapture();
+            ctx->mouse_state[button] &= ~BLINK_INPUT_DOWN;
+            ctx->mouse_state[button] |= BLINK_INPUT_RELEASED;
+        }
+
+    case WM_MOUSEMOVE:
+        wr = blink_get_adjusted_window_rect(ctx);
+        int prevx = ctx->mouse_pos.x;
+        int prevy = ctx->mouse_pos.y;
+        ctx->mouse_pos.x = (GET_X_LPARAM(lparam) - wr.x) * ctx->screen->w / wr.w;
+        ctx->mouse_pos.y = (GET_Y_LPARAM(lparam) - wr.y) * ctx->screen->h / wr.h;
+        ctx->mouse_delta.x += ctx->mouse_pos.x - prevx;
+        ctx->mouse_delta.y += ctx->mouse_pos.y - prevy;
+        break;
+
+    case WM_MOUSEWHEEL:
+        ctx->mouse_scroll = (float) GET_WHEEL_DELTA_WPARAM(wparam) / WHEEL_DELTA;
+        break;
+
+    case WM_SIZE:
+        if (wparam != SIZE_MINIMIZED) {
+            ctx->width = LOWORD(lparam);
+            ctx->height = HIWORD(lparam);
+            PAINTSTRUCT ps;
+            HDC hdc = BeginPaint(hwnd, &ps);
+            HBRUSH brush = CreateSolidBrush(RGB(0, 0, 0));
+            FillRect(hdc, &ps.rcPaint, brush);
+            DeleteObject(brush);
+            EndPaint(hwnd, &ps);
+            RedrawWindow(ctx->hwnd, 0, 0, RDW_INVALIDATE | RDW_UPDATENOW);
+        }
+        break;
+
+    case WM_QUIT:
+    case WM_CLOSE:
+        ctx->should_quit = true;
+        break;
+
+    default:
+unhandled:
+        return DefWindowProc(hwnd, message, wparam, lparam);
+    }
+
+    return 0;
+}
+
+static void blink_platform_init(blink_Context *ctx, const char *title) {
+    RegisterClass(&(WNDCLASS) {
+        .style = CS_OWNDC | CS_HREDRAW | CS_VREDRAW,
+        .lpfnWndProc = blink_wndproc,
+        .hCursor = LoadCursor(0, IDC_ARROW),
+        .lpszClassName = title
+    });
+
+    RECT rect = { .right = ctx->width, .bottom = ctx->height };
+    int style = WS_OVERLAPPEDWINDOW;
+    AdjustWindowRect(&rect, style, 0);
+    ctx->hwnd = CreateWindow(
+        title, title, style,
+        CW_USEDEFAULT, CW_USEDEFAULT,
+        rect.right - rect.left, rect.bottom - rect.top,
+        0, 0, 0, 0
+    );
+    SetProp(ctx->hwnd, "blink_Context", ctx);
+
+    BOOL dark = TRUE;
+    DwmSetWindowAttribute(ctx->hwnd, DWMWA_USE_IMMERSIVE_DARK_MODE, &dark, sizeof(dark));
+
+    ShowWindow(ctx->hwnd, SW_NORMAL);
+    ctx->hdc = GetDC(ctx->hwnd);
+
+    timeBeginPeriod(1);
+}
+
+static void blink_platform_deinit(blink_Context *ctx) {
+    timeEndPeriod(1);
+    ReleaseDC(ctx->hwnd, ctx->hdc);
+    DestroyWindow(ctx->hwnd);
+}
+
+static void blink_platform_present(blink_Context *ctx) {
+    blink_Rect wr = blink_get_adjusted_window_rect(ctx);
+    blink_Rect screen = blink_rect(0, 0, ctx->screen->w, ctx->screen->h);
+    for (int i = 0; i < ctx->dirty_count; i++) {
+        blink_Rect r = ctx->dirty[i];
+        r = blink_intersect_rects(blink_rect(r.x - 1, r.y - 1, r.w + 2, r.h + 2), screen);
+        blink_present_rect(ctx, wr, r);
+    }
+}
+
+static void blink_platform_poll(blink_Context *ctx) {
+    MSG msg;
+    while (PeekMessage(&msg, ctx->hwnd, 0, 0, PM_REMOVE)) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+}
+
+static double blink_platform_time(void) {
+    static LARGE_INTEGER freq;
+    if (!freq.QuadPart) { QueryPerformanceFrequency(&freq); }
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (double) now.QuadPart / (double) freq.QuadPart;
+}
+
+static void blink_platform_sleep(double seconds) {
+    Sleep(seconds * 1000);
+}
+#else
+/* headless runs stop on SIGINT/SIGTERM or after $BLINK_FRAMES frames */
+static volatile sig_atomic_t blink_quit_signal;
+static long blink_frame_limit, blink_frame_count;
+
+static void blink_handle_signal(int sig) {
+    blink_quit_signal = 1;
+}
+
+static void blink_platform_init(blink_Context *ctx, const char *title) {
+    const char *frames = getenv("BLINK_FRAMES");
+    blink_frame_limit = frames ? atol(frames) : 0;
+    blink_frame_count = 0;
+    signal(SIGINT, blink_handle_signal);
+    signal(SIGTERM, blink_handle_signal);
+}
+
+static void blink_platform_deinit(blink_Context *ctx) {}
+static void blink_platform_present(blink_Context *ctx) {}
+
+static void blink_platform_poll(blink_Context *ctx) {
+    blink_frame_count++;
+    if (blink_quit_signal || (blink_frame_limit > 0 && blink_frame_count > blink_frame_limit)) {
+        ctx->should_quit = true;
+    }
+}
+
+static double blink_platform_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void blink_platform_sleep(double seconds) {
+    struct timespec ts = { (time_t) seconds, (long) ((seconds - (time_t) seconds) * 1e9) };
+    nanosleep(&ts, NULL);
+}
+#endif
+
+#define BLINK_PROFILE_FRAMES 128
+#define BLINK_PROFILE_SCOPES 64
+#define BLINK_PROFILE_DEPTH 16
+
+typedef struct {
+    const char *name;
+    double start, time;
+    int depth, calls;
+} blink_Scope;
+
+struct blink_Profiler {
+    blink_Scope scopes[BLINK_PROFILE_FRAMES][BLINK_PROFILE_SCOPES];
+    int count[BLINK_PROFILE_FRAMES];
+    double start[BLINK_PROFILE_FRAMES];
+    double time[BLINK_PROFILE_FRAMES];
+    int frame, frames;
+    int stack[BLINK_PROFILE_DEPTH];
+    int depth;
+};
+
+static void blink_profile_add(blink_Profiler *p, const char *name, double start, double time) {
+    blink_Scope *s = p->scopes[p->frame];
+    int n = p->count[p->frame];
+    if (n > 0 && s[n - 1].depth == p->depth && !strcmp(s[n - 1].name, name)) {
+        s[n - 1].time += time;
+        s[n - 1].calls++;
+        return;
+    }
+    if (n == BLINK_PROFILE_SCOPES) { return; }
+    s[n] = (blink_Scope) { name, start, time, p->depth, 1 };
+    p->count[p->frame]++;
+}
+
+static void blink_profile_frame(blink_Profiler *p, double now) {
+    p->time[p->frame] = now - p->start[p->frame];
+    p->frame = (p->frame + 1) % BLINK_PROFILE_FRAMES;
+    p->frames = blink_min(p->frames + 1, BLINK_PROFILE_FRAMES - 1);
+    p->count[p->frame] = 0;
+    p->start[p->frame] = now;
+    p->depth = 0;
+}
+
+static double blink_profile_now(blink_Context *ctx) {
+    return ctx->profiler ? blink_platform_time() : 0;
+}
+
+static void blink_profile_draw(blink_Context *ctx, double start) {
+    if (ctx->profiler) {
+        blink_profile_add(ctx->profiler, "draw", start, blink_platform_time() - start);
+    }
+}
+
+static blink_Color blink_profile_color(const char *name) {
+    static const blink_Color palette[] = {
+        blink_rgb(0xe6, 0x55, 0x4e), blink_rgb(0x4e, 0xa8, 0xe6), blink_rgb(0x7c, 0xd1, 0x5a),
+        blink_rgb(0xe6, 0xb8, 0x3c), blink_rgb(0xb0, 0x6e, 0xe6), blink_rgb(0x3c, 0xd6, 0xc4),
+        blink_rgb(0xe6, 0x7c, 0xb8), blink_rgb(0xc8, 0xc8, 0x8c)
+    };
+    uint32_t h = 2166136261u;
+    for (; *name; name++) { h = (h ^ (uint8_t) *name) * 16777619u; }
+    return palette[h % blink_lengthof(palette)];
+}
+
+struct blink_Load {
+    blink_Loader *loader;
+    blink_Load *next;
+    blink_Image *image;
+    int flags;
+    bool decoded;
+    bool ready;
+    char filename[];
+};
+
+struct blink_Loader {
+    blink_Pool *pool;
+    blink_Mutex lock;
+    blink_Cond done;
+    blink_Load *loads;
+};
+
+static void blink_run_load(void *arg, int index) {
+    blink_Load *load = arg;
+    blink_Image *img = blink_load_image_file2(load->filename, load->flags);
+    blink_mutex_lock(&load->loader->lock);
+    load->image = img;
+    load->decoded = true;
+    blink_cond_broadcast(&load->loader->done);
+    blink_mutex_unlock(&load->loader->lock);
+}
+
+static void blink_destroy_loader(blink_Loader *loader) {
+    if (!loader) { return; }
+    blink_pool_wait(loader->pool);
+    blink_destroy_pool(loader->pool);
+    while (loader->loads) {
+        blink_Load *next = loader->loads->next;
+        if (loader->loads->image) { blink_destroy_image(loader->loads->image); }
+        free(loader->loads);
+        loader->loads = next;
+    }
+    blink_cond_destroy(&loader->done);
+    blink_mutex_destroy(&loader->lock);
+    free(loader);
+}
+
+static void blink_poll_loads(blink_Loader *loader) {
+    if (!loader) { return; }
+    blink_mutex_lock(&loader->lock);
+    for (blink_Load *l = loader->loads; l; l = l->next) {
+        if (l->decoded) { l->ready = true; }
+    }
+    blink_mutex_unlock(&loader->lock);
+}
+
+#define BLINK_AUDIO_RATE 44100
+#define BLINK_AUDIO_CHANNELS 2
+#define BLINK_MUSIC_RING 8192
+#define BLINK_MUSIC_CHUNK 1024
+#define BLINK_MAX_VOICES 64
+#define BLINK_VOICE_COMMANDS 256
+#define BLINK_VOICE_FINISHED 1024
+#define BLINK_MIN_PITCH (1.0f / 64)
+#define BLINK_MAX_PITCH 64.0f
+
+#define blink_atomic_load(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define blink_atomic_store(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+struct blink_Music {
+    blink_Audio *audio;
+    blink_File *file;
+    stb_vorbis *vorbis;
+    int channels;
+    ma_data_converter converter;
+    float *buf;
+    int offset, pending;
+};
+
+struct blink_Sound {
+    int frames, channels;
+    int refs;
+    float samples[];
+};
+
+typedef struct {
+    blink_Sound *sound;
+    uint32_t id;
+    double pos;
+    float gain, pan, pitch;
+    bool loop, done;
+} blink_Voice;
+
+enum { BLINK_VOICE_PLAY, BLINK_VOICE_SET, BLINK_VOICE_STOP };
+
+typedef struct {
+    int type;
+    blink_Voice voice;
+} blink_VoiceCommand;
+
+typedef struct {
+    uint8_t *items;
+    int size, mask;
+    uint32_t head, tail;
+} blink_Queue;
+
+struct blink_Audio {
+    ma_context context;
+    ma_device device;
+    bool has_context, has_device, has_thread;
+    ma_pcm_rb ring;
+    blink_Mutex lock;
+    blink_Cond wake;
+    blink_Thread thread;
+    bool quit;
+    blink_Music *music;
+    bool loop;
+    uint32_t flush, flush_ack, flush_seen;
+    float music_volume;
+    blink_Voice voices[BLINK_MAX_VOICES];
+    struct { uint32_t id, seq; int priority; } slots[BLINK_MAX_VOICES];
+    uint32_t seq;
+    blink_Queue commands, finished;
+};
+
+/* the low byte of a voice id is its slot + 1; ids come from callers and may be stale or garbage */
+static bool blink_valid_voice(uint32_t id) {
+    return (id & 0xff) >= 1 && (id & 0xff) <= BLINK_MAX_VOICES;
+}
+
+static void blink_init_queue(blink_Queue *q, int size, int capacity) {
+    q->items = blink_alloc(size * capacity);
+    q->size = size;
+    q->mask = capacity - 1;
+}
+
+static bool blink_queue_push(blink_Queue *q, const void *item) {
+    uint32_t tail = q->tail;
+    if (tail - blink_atomic_load(&q->head) > q->mask) { return false; }
+    memcpy(q->items + (tail & q->mask) * q->size, item, q->size);
+    blink_atomic_store(&q->tail, tail + 1);
+    return true;
+}
+
+static bool blink_queue_peek(blink_Queue *q, void *item) {
+    uint32_t head = q->head;
+    if (head == blink_atomic_load(&q->tail)) { return false; }
+    memcpy(item, q->items + (head & q->mask) * q->size, q->size);
+    return true;
+}
+
+static void blink_queue_skip(blink_Queue *q) {
+    blink_atomic_store(&q->head, q->head + 1);
+}
+
+static bool blink_queue_pop(blink_Queue *q, void *item) {
+    if (!blink_queue_peek(q, item)) { return false; }
+    blink_queue_skip(q);
+    return true;
+}
+
+static blink_Sound *blink_alloc_sound(int frames, int channels) {
+    blink_Sound *sound = blink_alloc(sizeof(blink_Sound) + frames * channels * sizeof(float));
+    sound->frames = frames;
+    sound->channels = channels;
+    sound->refs = 1;
+    return sound;
+}
+
+static void blink_release_sound(blink_Sound *sound) {
+    if (--sound->refs == 0) { free(sound); }
+}
+
+static void blink_reap_voices(blink_Audio *a) {
+    blink_Voice done;
+    while (blink_queue_pop(&a->finished, &done)) {
+        int slot = (done.id & 0xff) - 1;
+        if (a->slots[slot].id == done.id) { a->slots[slot].id = 0; }
+        blink_release_sound(done.sound);
+    }
+}
+
+/* hands the voice's sound reference back to the game thread; if the
+ * finished queue is full the voice stays occupied (but silent) and the
+ * push is retried on the next callback */
+static bool blink_finish_voice(blink_Audio *a, blink_Voice *v) {
+    if (!v->sound) { return true; }
+    if (!blink_queue_push(&a->finished, v)) {
+        v->done = true;
+        return false;
+    }
+    v->sound = NULL;
+    v->done = false;
+    return true;
+}
+
+static void blink_run_voice_commands(blink_Audio *a) {
+    blink_VoiceCommand cmd;
+    while (blink_queue_peek(&a->commands, &cmd)) {
+        if (!blink_valid_voice(cmd.voice.id)) {
+            blink_queue_skip(&a->commands);
+            continue;
+        }
+        blink_Voice *v = &a->voices[(cmd.voice.id & 0xff) - 1];
+        if (cmd.type == BLINK_VOICE_PLAY) {
+            if (!blink_finish_voice(a, v)) { break; }
+            *v = cmd.voice;
+        } else if (v->sound && v->id == cmd.voice.id) {
+            if (cmd.type == BLINK_VOICE_STOP) {
+                blink_finish_voice(a, v);
+            } else {
+                v->gain = cmd.voice.gain;
+                v->pan = cmd.voice.pan;
+                v->pitch = cmd.voice.pitch;
+            }
+        }
+        blink_queue_skip(&a->commands);
+    }
+}
+
+/* NaN would stall or poison the mix and a pitch of 0 never finishes,
+ * so every parameter is pinned to a usable range */
+static void blink_set_voice_params(blink_Voice *v, float gain, float pan, float pitch) {
+    v->gain = isnan(gain) ? 0 : gain;
+    v->pan = isnan(pan) ? 0 : blink_max(-1, blink_min(pan, 1));
+    v->pitch = isnan(pitch) ? 1 : blink_max(BLINK_MIN_PITCH, blink_min(pitch, BLINK_MAX_PITCH));
+}
+
+static bool blink_mix_voice(blink_Voice *v, float *out, int frames) {
+    blink_Sound *s = v->sound;
+    int ch = s->channels;
+    float l = v->gain * (v->pan > 0 ? 1 - v->pan : 1);
+    float r = v->gain * (v->pan < 0 ? 1 + v->pan : 1);
+    int i = 0;
+    while (i < frames) {
+        if (v->pitch == 1 && v->pos == (int) v->pos) {
+            int pos = (int) v->pos;
+            int n = blink_min(frames - i, s->frames - pos);
+            blink_MixFn mix = ch == 1 ? blink_kernels.mix_mono : blink_kernels.mix_stereo;
+            mix(out + i * 2, s->samples + pos * ch, n, l, r);
+            i += n;
+            v->pos += n;
+        } else {
+            for (; i < frames && v->pos < s->frames; i++, v->pos += v->pitch) {
+                int pos = (int) v->pos;
+                float t = v->pos - pos;
+                int next = pos + 1 < s->frames ? pos + 1 : v->loop ? 0 : pos;
+                const float *a = s->samples + pos * ch, *b = s->samples + next * ch;
+                float sl = a[0] + (b[0] - a[0]) * t;
+                float sr = ch == 2 ? a[1] + (b[1] - a[1]) * t : sl;
+                out[i * 2] += sl * l;
+                out[i * 2 + 1] += sr * r;
+            }
+        }
+        if (v->pos >= s->frames) {
+            if (!v->loop) { return true; }
+            v->pos = fmod(v->pos, s->frames);
+        }
+    }
+    return false;
+}
+
+static float blink_load_float(float *p) {
+    float v;
+    __atomic_load(p, &v, __ATOMIC_RELAXED);
+    return v;
+}
+
+static void blink_store_float(float *p, float v) {
+    __atomic_store(p, &v, __ATOMIC_RELAXED);
+}
+
+static void blink_sync_flush(blink_Audio *a) {
+    uint32_t flush = blink_atomic_load(&a->flush);
+    if (flush != a->flush_seen) {
+        ma_pcm_rb_seek_read(&a->ring, ma_pcm_rb_available_read(&a->ring));
+        a->flush_seen = flush;
+        blink_atomic_store(&a->flush_ack, flush);
+    }
+}
+
+static void blink_mix_audio(blink_Audio *a, float *out, int frames) {
+    memset(out, 0, frames * BLINK_AUDIO_CHANNELS * sizeof(float));
+    blink_sync_flush(a);
+    float volume = blink_load_float(&a->music_volume);
+    int done = 0;
+    while (done < frames) {
+        ma_uint32 n = frames - done;
+        void *p;
+        ma_pcm_rb_acquire_read(&a->ring, &n, &p);
+        if (n == 0) { break; }
+        float *src = p, *dst = out + done * BLINK_AUDIO_CHANNELS;
+        for (int i = 0; i < n * BLINK_AUDIO_CHANNELS; i++) { dst[i] += src[i] * volume; }
+        ma_pcm_rb_commit_read(&a->ring, n);
+        done += n;
+    }
+
+    for (int i = 0; i < BLINK_MAX_VOICES; i++) {
+        if (a->voices[i].done) { blink_finish_voice(a, &a->voices[i]); }
+    }
+    blink_run_voice_commands(a);
+    for (int i = 0; i < BLINK_MAX_VOICES; i++) {
+        blink_Voice *v = &a->voices[i];
+        if (v->sound && !v->done && blink_mix_voice(v, out, frames)) { blink_finish_voice(a, v); }
+    }
+}
+
+static void blink_audio_callback(ma_device *device, void *out, const void *in, ma_uint32 frames) {
+    blink_mix_audio(device->pUserData, out, frames);
+}
+
+static void blink_stream_music(blink_Audio *a) {
+    blink_Music *m = a->music;
+    if (!m || blink_atomic_load(&a->flush_ack) != a->flush) { return; }
+    bool rewound = false;
+    for (;;) {
+        ma_uint32 frames = ma_pcm_rb_available_write(&a->ring);
+        if (frames == 0) { break; }
+        if (m->pending == 0) {
+            int n = stb_vorbis_get_samples_float_interleaved(m->vorbis, m->channels, m->buf, BLINK_MUSIC_CHUNK * m->channels);
+            if (n == 0) {
+                if (!a->loop || rewound) {
+                    a->music = NULL;
+                    break;
+                }
+                stb_vorbis_seek_start(m->vorbis);
+                rewound = true;
+                continue;
+            }
+            rewound = false;
+            m->offset = 0;
+            m->pending = n;
+        }
+        void *out;
+        ma_pcm_rb_acquire_write(&a->ring, &frames, &out);
+        ma_uint64 in = m->pending, produced = frames;
+        ma_data_converter_process_pcm_frames(&m->converter, m->buf + m->offset * m->channels, &in, out, &produced);
+        ma_pcm_rb_commit_write(&a->ring, produced);
+        m->offset += in;
+        m->pending -= in;
+        if (in == 0 && produced == 0) { break; }
+    }
+}
+
+static void blink_audio_main(void *arg) {
+    blink_Audio *a = arg;
+    blink_mutex_lock(&a->lock);
+    while (!a->quit) {
+        if (!a->music) {
+            blink_cond_wait(&a->wake, &a->lock);
+            continue;
+        }
+        blink_stream_music(a);
+        blink_mutex_unlock(&a->lock);
+        blink_platform_sleep(0.005);
+        blink_mutex_lock(&a->lock);
+    }
+    blink_mutex_unlock(&a->lock);
+}
+
+static void blink_set_music(blink_Audio *a, blink_Music *music, bool loop) {
+    blink_mutex_lock(&a->lock);
+    if (music) {
+        stb_vorbis_seek_start(music->vorbis);
+        ma_data_converter_reset(&music->converter);
+        music->pending = 0;
+    }
+    a->music = music;
+    a->loop = loop;
+    blink_atomic_store(&a->flush, a->flush + 1);
+    blink_cond_signal(&a->wake);
+    blink_mutex_unlock(&a->lock);
+}
+
+static bool blink_start_audio_device(blink_Audio *a, int flags) {
+    ma_device_config cfg = ma_device_config_init(ma_device_type_playback);
+    cfg.playback.format = ma_format_f32;
+    cfg.playback.channels = BLINK_AUDIO_CHANNELS;
+    cfg.sampleRate = BLINK_AUDIO_RATE;
+    cfg.dataCallback = blink_audio_callback;
+    cfg.pUserData = a;
+
+    ma_context *context = NULL;
+    if (flags & BLINK_AUDIO_NULL) {
+        ma_backend backend = ma_backend_null;
+        if (ma_context_init(&backend, 1, NULL, &a->context) != MA_SUCCESS) { return false; }
+        a->has_context = true;
+        context = &a->context;
+    }
+    if (ma_device_init(context, &cfg, &a->device) != MA_SUCCESS) { return false; }
+    a->has_device = true;
+
+    a->thread = blink_create_thread(blink_audio_main, a);
+    a->has_thread = true;
+    return ma_device_start(&a->device) == MA_SUCCESS;
+}
+
+static void blink_close_audio(blink_Audio *a) {
+    if (!a) { return; }
+    if (a->has_device) { ma_device_uninit(&a->device); }
+    if (a->has_context) { ma_context_uninit(&a->context); }
+    if (a->has_thread) {
+        blink_mutex_lock(&a->lock);
+        a->quit = true;
+        blink_cond_signal(&a->wake);
+        blink_mutex_unlock(&a->lock);
+        blink_join_thread(a->thread);
+    }
+    do {
+        blink_reap_voices(a);
+        blink_run_voice_commands(a);
+    } while (a->commands.head != a->commands.tail);
+    for (int i = 0; i < BLINK_MAX_VOICES; i++) {
+        while (!blink_finish_voice(a, &a->voices[i])) { blink_reap_voices(a); }
+    }
+    blink_reap_voices(a);
+    free(a->commands.items);
+    free(a->finished.items);
+    ma_pcm_rb_uninit(&a->ring);
+    blink_cond_destroy(&a->wake);
+    blink_mutex_destroy(&a->lock);
+    free(a);
+}
+
+static void *blink_font_data;
+static int blink_font_size;
+
+blink_Context *blink_create(const char *title, int width, int height, int scale) {
+    blink_Context *ctx = blink_alloc(sizeof(blink_Context));
+    blink_init_kernels();
+
+    ctx->screen = blink_create_image(width, height);
+    ctx->clip = blink_rect(0, 0, width, height);
+    ctx->width = width * scale;
+    ctx->height = height * scale;
+
+    blink_platform_init(ctx, title);
+
+    ctx->prev_time = blink_platform_time();
+    ctx->sleep_error = 0.002;
+
+    ctx->font = blink_load_font_mem(blink_font_data, blink_font_size);
+
+    return ctx;
+}
+
+void blink_destroy(blink_Context *ctx) {
+    blink_destroy_pool(ctx->pool);
+    blink_destroy_loader(ctx->loader);
+    blink_close_audio(ctx->audio);
+    free(ctx->profiler);
+    if (ctx->commands) {
+        free(ctx->commands->commands);
+        free(ctx->commands->data);
+        free(ctx->commands->tile_start);
+        free(ctx->commands->items);
+        free(ctx->commands->tile_stats);
+        free(ctx->commands);
+    }
+    blink_platform_deinit(ctx);
+    blink_destroy_image(ctx->screen);
+    blink_destroy_font(ctx->font);
+    free(ctx);
+}
+
+static void blink_wait_until(blink_Context *ctx, double target) {
+    double now = blink_platform_time();
+    while (target - now > ctx->sleep_error) {
+        blink_platform_sleep(0.001);
+        double then = blink_platform_time();
+        double error = (then - now) - 0.001;
+        if (error > ctx->sleep_error) {
+            ctx->sleep_error = error;
+        } else {
+            ctx->sleep_error += (error - ctx->sleep_error) * 0.05;
+        }
+        now = then;
+    }
+    while (now < target) {
+        now = blink_platform_time();
+    }
+}
+
+bool blink_update(blink_Context *ctx, double *dt) {
+    blink_profile_begin(ctx, "flush");
+    blink_flush(ctx);
+    blink_profile_end(ctx);
+
+    ctx->prev_stats = ctx->stats;
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+
+    if (ctx->dirty_count) {
+        blink_profile_begin(ctx, "present");
+        blink_platform_present(ctx);
+        blink_profile_end(ctx);
+        ctx->dirty_count = 0;
+    }
+
+    double now = blink_platform_time();
+    double wait = (ctx->prev_time + ctx->step_time) - now;
+    double prev = ctx->prev_time;
+    if (wait > 0) {
+        ctx->prev_time += ctx->step_time;
+        blink_profile_begin(ctx, "sleep");
+        blink_wait_until(ctx, ctx->prev_time);
+        blink_profile_end(ctx);
+    } else {
+        ctx->prev_time = now;
+    }
+    if (dt) { *dt = ctx->prev_time - prev; }
+
+    memset(ctx->char_buf, 0, sizeof(ctx->char_buf));
+    for (int i = 0; i < sizeof(ctx->key_state); i++) {
+        ctx->key_state[i] &= ~(BLINK_INPUT_PRESSED | BLINK_INPUT_RELEASED);
+    }
+    for (int i = 0; i < sizeof(ctx->mouse_state); i++) {
+        ctx->mouse_state[i] &= ~(BLINK_INPUT_PRESSED | BLINK_INPUT_RELEASED);
+    }
+    ctx->mouse_scroll = 0;
+
+    blink_profile_begin(ctx, "poll");
+    blink_platform_poll(ctx);
+    blink_poll_loads(ctx->loader);
+    if (ctx->audio) { blink_reap_voices(ctx->audio); }
+    blink_profile_end(ctx);
+
+    if (ctx->fixed_update) {
+        blink_profile_begin(ctx, "fixed update");
+        ctx->accumulator += ctx->prev_time - prev;
+        int steps = 0;
+        while (ctx->accumulator >= ctx->fixed_step && steps < ctx->max_steps) {
+            ctx->fixed_update(ctx->fixed_udata, ctx->fixed_step);
+            ctx->accumulator -= ctx->fixed_step;
+            steps++;
+        }
+        if (ctx->accumulator >= ctx->fixed_step) {
+            ctx->accumulator = fmod(ctx->accumulator, ctx->fixed_step);
+        }
+        blink_profile_end(ctx);
+    }
+
+    if (ctx->profiler) { blink_profile_frame(ctx->profiler, blink_platform_time()); }
+
+    return !ctx->should_quit;
+}
+
+double blink_get_time(void) {
+    return blink_platform_time();
+}
+
+void blink_set_target_fps(blink_Context *ctx, int fps) {
+    if (fps < 1) {
+        ctx->step_time = 0;
+    } else {
+        ctx->step_time = 1.0 / (double)fps;
+    }
+}
+
+void blink_set_fixed_update(blink_Context *ctx, void (*fn)(void *udata, double dt), void *udata, int rate, int max_steps) {
+    ctx->fixed_update = rate > 0 ? fn : NULL;
+    ctx->fixed_udata = udata;
+    ctx->fixed_step = rate > 0 ? 1.0 / (double)rate : 0;
+    ctx->max_steps = blink_max(max_steps, 1);
+    ctx->accumulator = 0;
+}
+
+double blink_get_alpha(blink_Context *ctx) {
+    if (!ctx->fixed_update) { return 1; }
+    return ctx->accumulator / ctx->fixed_step;
+}
+
+void blink_set_cursor_hidden(blink_Context *ctx, bool hidden) {
+    ctx->hide_cursor = hidden;
+}
+
+typedef struct {
+    uint32_t hash;
+    int name;
+    uint32_t offset, size;
+} blink_PackEntry;
+
+struct blink_Pack {
+    blink_Mapping map;
+    blink_PackEntry *entries;
+    int cap;
+    char *names;
+    blink_Pack *next;
+};
+
+static blink_Pack *blink_packs;
+
+static const char *blink_trim_path(const char *path) {
+    while (path[0] == '.' && (path[1] == '/' || path[1] == '\\')) { path += 2; }
+    return path;
+}
+
+static uint32_t blink_hash_path(const char *path) {
+    uint32_t h = 2166136261u;
+    for (; *path; path++) { h = (h ^ (uint8_t) (*path == '\\' ? '/' : *path)) * 16777619u; }
+    return h;
+}
+
+static bool blink_path_equal(const char *a, const char *b) {
+    for (; *a && *b; a++, b++) {
+        if ((*a == '\\' ? '/' : *a) != (*b == '\\' ? '/' : *b)) { return false; }
+    }
+    return *a == *b;
+}
+
+static int blink_pack_read(mtar_t *tar, void *data, unsigned size) {
+    blink_Mapping *map = tar->stream;
+    if (tar->pos + (size_t) size > map->size) { return MTAR_EREADFAIL; }
+    memcpy(data, (uint8_t*) map->data + tar->pos, size);
+    return MTAR_ESUCCESS;
+}
+
+static int blink_pack_seek(mtar_t *tar, unsigned pos) {
+    blink_Mapping *map = tar->stream;
+    return pos <= map->size ? MTAR_ESUCCESS : MTAR_ESEEKFAIL;
+}
+
+static bool blink_pack_next(mtar_t *tar, mtar_header_t *h, size_t size) {
+    if (h->size > size - tar->pos - 512) { return false; }
+    size_t next = (size_t) tar->pos + 512 + (((size_t) h->size + 511) & ~(size_t) 511);
+    mtar_seek(tar, blink_min(next, size));
+    return true;
+}
+
+static blink_PackEntry *blink_pack_find(blink_Pack *pack, const char *name) {
+    uint32_t h = blink_hash_path(name);
+    for (int i = h & (pack->cap - 1);; i = (i + 1) & (pack->cap - 1)) {
+        blink_PackEntry *e = &pack->entries[i];
+        if (e->name < 0) { return NULL; }
+        if (e->hash == h && blink_path_equal(pack->names + e->name, name)) { return e; }
+    }
+}
+
+blink_Pack *blink_mount_pack(const char *filename) {
+    blink_Mapping map;
+    if (!blink_map_file(filename, &map)) { return NULL; }
+    if (map.size > UINT32_MAX) {
+        blink_unmap_file(&map);
+        return NULL;
+    }
+
+    mtar_t tar = { .read = blink_pack_read, .seek = blink_pack_seek, .stream = &map };
+    mtar_header_t h;
+    int count = 0, names_len = 0;
+    while (mtar_read_header(&tar, &h) == MTAR_ESUCCESS) {
+        if (h.type == MTAR_TREG) {
+            count++;
+            names_len += strlen(blink_trim_path(h.name)) + 1;
+        }
+        if (!blink_pack_next(&tar, &h, map.size)) {
+            count = 0;
+            break;
+        }
+    }
+    if (count == 0) {
+        blink_unmap_file(&map);
+        return NULL;
+    }
+
+    blink_Pack *pack = blink_alloc(sizeof(blink_Pack));
+    pack->map = map;
+    pack->cap = 16;
+    while (pack->cap < count * 2) { pack->cap *= 2; }
+    pack->entries = blink_alloc(pack->cap * sizeof(blink_PackEntry));
+    for (int i = 0; i < pack->cap; i++) { pack->entries[i].name = -1; }
+    pack->names = blink_alloc(names_len + 1);
+
+    int names = 0;
+    mtar_rewind(&tar);
+    while (mtar_read_header(&tar, &h) == MTAR_ESUCCESS) {
+        uint32_t offset = tar.pos + 512;
+        if (h.type == MTAR_TREG) {
+            const char *name = blink_trim_path(h.name);
+            blink_PackEntry *e = blink_pack_find(pack, name);
+            if (!e) {
+                uint32_t hash = blink_hash_path(name);
+                int i = hash & (pack->cap - 1);
+                while (pack->entries[i].name >= 0) { i = (i + 1) & (pack->cap - 1); }
+                e = &pack->entries[i];
+                e->hash = hash;
+                e->name = names;
+                strcpy(pack->names + names, name);
+                names += strlen(name) + 1;
+            }
+            e->offset = offset;
+            e->size = h.size;
+        }
+        blink_pack_next(&tar, &h, map.size);
+    }
+
+    pack->next = blink_packs;
+    blink_packs = pack;
+    return pack;
+}
+
+void blink_unmount_pack(blink_Pack *pack) {
+    blink_Pack **p = &blink_packs;
+    while (*p && *p != pack) { p = &(*p)->next; }
+    if (*p) { *p = pack->next; }
+    blink_unmap_file(&pack->map);
+    free(pack->entries);
+    free(pack->names);
+    free(pack);
+}
+
+struct blink_File {
+    const void *data;
+    size_t size;
+    blink_Mapping map;
+    bool mapped;
+    void *buf;
+};
+
+blink_File *blink_open_file(const char *filename) {
+    blink_File *f = blink_alloc(sizeof(blink_File));
+    const char *name = blink_trim_path(filename);
+    for (blink_Pack *pack = blink_packs; pack; pack = pack->next) {
+        blink_PackEntry *e = blink_pack_find(pack, name);
+        if (e) {
+            f->data = (uint8_t*) pack->map.data + e->offset;
+            f->size = e->size;
+            return f;
+        }
+    }
+
+    if (blink_map_file(filename, &f->map)) {
+        f->mapped = true;
+        f->data = f->map.data;
+        f->size = f->map.size;
+        return f;
+    }
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        free(f);
+        return NULL;
+    }
+    size_t cap = 0;
+    for (;;) {
+        if (f->size == cap) {
+            cap = cap ? cap * 2 : 4096;
+            f->buf = realloc(f->buf, cap);
+            if (!f->buf) { blink_panic("out of memory"); }
+        }
+        size_t n = fread((char*) f->buf + f->size, 1, cap - f->size, fp);
+        if (n == 0) { break; }
+        f->size += n;
+    }
+    fclose(fp);
+    f->data = f->buf;
+    return f;
+}
+
+const void *blink_file_data(blink_File *f) {
+    return f->data;
+}
+
+size_t blink_file_size(blink_File *f) {
+    return f->size;
+}
+
+void blink_close_file(blink_File *f) {
+    if (f->mapped) { blink_unmap_file(&f->map); }
+    free(f->buf);
+    free(f);
+}
+
+void *blink_read_file(const char *filename, int *len) {
+    blink_File *f = blink_open_file(filename);
+    if (!f) { return NULL; }
+    char *buf = blink_alloc(f->size + 1);
+    memcpy(buf, f->data, f->size);
+    if (len) { *len = f->size; }
+    blink_close_file(f);
+    return buf;
+}
+
+blink_Image *blink_create_image(int width, int height) {
+    blink_expect(width > 0 && height > 0);
+    blink_Image *img = blink_alloc(sizeof(blink_Image) + width * height * sizeof(blink_Color));
+    img->pixels = (void*) (img + 1);
+    img->w = width;
+    img->h = height;
+    return img;
+}
+
+blink_Image *blink_load_image_mem(void *data, int len) {
+    return blink_load_image_mem2(data, len, 0);
+}
+
+blink_Image *blink_load_image_mem2(void *data, int len, int flags) {
+    int x, y;
+    unsigned char *png = stbi_load_from_memory(data, len, &x, &y, NULL, 4);
+    if (!png) { return NULL; }
+    blink_Image *img = blink_create_image(x, y);
+    img->flags = flags & BLINK_IMAGE_PREMULTIPLIED;
+    blink_Color *d = img->pixels;
+    const uint8_t *p = png;
+    if (flags & BLINK_IMAGE_PREMULTIPLIED) {
+        for (int i = 0; i < x * y; i++, p += 4) {
+            d[i] = blink_premul_color(blink_rgba(p[0], p[1], p[2], p[3]));
+        }
+    } else {
+        for (int i = 0; i < x * y; i++, p += 4) {
+            d[i] = blink_rgba(p[0], p[1], p[2], p[3]);
+        }
+    }
+    free(png);
+
+    if (flags & BLINK_IMAGE_SPANS) { blink_build_image_spans(img); }
+
+    return img;
+}
+
+blink_Image *blink_load_image_file(const char *filename) {
+    return blink_load_image_file2(filename, 0);
+}
+
+blink_Image *blink_load_image_file2(const char *filename, int flags) {
+    blink_File *f = blink_open_file(filename);
+    if (!f) { return NULL; }
+    blink_Image *res = blink_load_image_mem2((void*) f->data, f->size, flags);
+    blink_close_file(f);
+    return res;
+}
+
+typedef struct {
+    const char **filenames;
+    void **data;
+    int *lens;
+    int flags;
+    blink_Image **out;
+} blink_Batch;
+
+static void blink_run_batch(void *arg, int index) {
+    blink_Batch *b = arg;
+    if (b->filenames) {
+        b->out[index] = blink_load_image_file2(b->filenames[index], b->flags);
+    } else {
+        b->out[index] = blink_load_image_mem2(b->data[index], b->lens[index], b->flags);
+    }
+}
+
+static int blink_load_batch(blink_Batch *b, int count) {
+    int threads = blink_min(blink_cpu_count(), count) - 1;
+    blink_Pool *pool = blink_create_pool(blink_max(threads, 0));
+    for (int i = 0; i < count; i++) {
+        blink_pool_push(pool, blink_run_batch, b, i);
+    }
+    blink_pool_wait(pool);
+    blink_destroy_pool(pool);
+
+    int res = 0;
+    for (int i = 0; i < count; i++) { res += b->out[i] != NULL; }
+    return res;
+}
+
+int blink_load_images_mem(void **data, int *lens, int count, int flags, blink_Image **out) {
+    blink_Batch b = { NULL, data, lens, flags, out };
+    return blink_load_batch(&b, count);
+}
+
+int blink_load_images_file(const char **filenames, int count, int flags, blink_Image **out) {
+    blink_Batch b = { filenames, NULL, NULL, flags, out };
+    return blink_load_batch(&b, count);
+}
+
+void blink_build_image_spans(blink_Image *img) {
+    free(img->spans);
+    img->spans = NULL;
+
+    uint32_t *runs = NULL;
+    int count = 0, cap = 0;
+    bool premul = img->flags & BLINK_IMAGE_PREMULTIPLIED;
+    int *rows = blink_alloc((img->h + 1) * sizeof(int));
+    for (int y = 0; y < img->h; y++) {
+        blink_Color *p = &img->pixels[y * img->w];
+        rows[y] = count;
+        int x = 0;
+        while (x < img->w) {
+            int kind = blink_span_kind(p[x], premul), len = 1;
+            while (x + len < img->w && blink_span_kind(p[x + len], premul) == kind) { len++; }
+            if (len < BLINK_SPAN_MIN) { kind = BLINK_SPAN_BLEND; }
+            if (count > rows[y] && (runs[count - 1] & 3) == kind) {
+                runs[count - 1] += len << 2;
+            } else {
+                runs = blink_grow(runs, &cap, count + 1, sizeof(uint32_t));
+                runs[count++] = (len << 2) | kind;
+            }
+            x += len;
+        }
+    }
+    rows[img->h] = count;
+
+    int size = (img->h + 1) * sizeof(int);
+    blink_Spans *spans = blink_alloc(sizeof(blink_Spans) + size + count * sizeof(uint32_t));
+    spans->rows = (void*) (spans + 1);
+    spans->runs = (void*) ((char*) spans->rows + size);
+    memcpy(spans->rows, rows, size);
+    memcpy(spans->runs, runs, count * sizeof(uint32_t));
+    free(rows);
+    free(runs);
+    img->spans = spans;
+}
+
+typedef struct {
+    blink_Image image;
+    blink_Mapping map;
+} blink_MappedImage;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t w, h, flags;
+    uint32_t pixels;
+    uint32_t spans;
+    uint32_t span_count;
+    uint8_t reserved[32];
+} blink_BimgHeader;
+
+#define BLINK_BIMG_VERSION 1
+#define BLINK_BIMG_ALIGN 64
+
+void blink_destroy_image(blink_Image *img) {
+    free(img->spans);
+    if (img->flags & BLINK_IMAGE_MAPPED) {
+        blink_unmap_file(&((blink_MappedImage*) img)->map);
+    }
+    free(img);
+}
+
+bool blink_save_bimg(blink_Image *img, const char *filename) {
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) { return false; }
+
+    uint32_t size = img->w * img->h * sizeof(blink_Color);
+    blink_BimgHeader hdr = {
+        .magic = { 'B', 'I', 'M', 'G' },
+        .version = BLINK_BIMG_VERSION,
+        .w = img->w,
+        .h = img->h,
+        .flags = img->flags & BLINK_IMAGE_PREMULTIPLIED,
+        .pixels = BLINK_BIMG_ALIGN
+    };
+    if (img->spans) {
+        hdr.flags |= BLINK_IMAGE_SPANS;
+        hdr.spans = hdr.pixels + size;
+        hdr.span_count = img->spans->rows[img->h];
+    }
+
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    fwrite(img->pixels, 1, size, fp);
+    if (img->spans) {
+        fwrite(img->spans->rows, sizeof(int), img->h + 1, fp);
+        fwrite(img->spans->runs, sizeof(uint32_t), hdr.span_count, fp);
+    }
+
+    bool ok = !ferror(fp);
+    return fclose(fp) == 0 && ok;
+}
+
+/* the span walkers trust rows and run lengths, so file data is checked once here */
+static bool blink_check_spans(const int *rows, const uint32_t *runs, int w, int h, uint32_t count) {
+    if (rows[0] != 0 || (uint32_t) rows[h] != count) { return false; }
+    for (int y = 0; y < h; y++) {
+        if (rows[y + 1] < rows[y]) { return false; }
+        int64_t len = 0;
+        for (int i = rows[y]; i < rows[y + 1]; i++) {
+            if ((runs[i] & 3) > BLINK_SPAN_BLEND || (runs[i] >> 2) == 0) { return false; }
+            len += runs[i] >> 2;
+        }
+        if (len != w) { return false; }
+    }
+    return true;
+}
+
+blink_Image *blink_load_bimg(const char *filename) {
+    blink_Mapping map;
+    if (!blink_map_file(filename, &map)) { return NULL; }
+
+    blink_BimgHeader *hdr = map.data;
+    uint64_t pixels_end = 0, spans_end = 0;
+    bool ok = map.size >= sizeof(*hdr) && !memcmp(hdr->magic, "BIMG", 4) && hdr->version == BLINK_BIMG_VERSION;
+    if (ok) {
+        pixels_end = hdr->pixels + (uint64_t) hdr->w * hdr->h * sizeof(blink_Color);
+        spans_end = hdr->spans + (uint64_t) (hdr->h + 1) * sizeof(int) + (uint64_t) hdr->span_count * sizeof(uint32_t);
+        ok = hdr->w > 0 && hdr->h > 0 && hdr->pixels % BLINK_BIMG_ALIGN == 0 && pixels_end <= map.size;
+    }
+    if (ok && (hdr->flags & BLINK_IMAGE_SPANS)) {
+        ok = hdr->spans >= pixels_end && hdr->spans % sizeof(int) == 0 && spans_end <= map.size;
+    }
+    if (!ok) {
+        blink_unmap_file(&map);
+        return NULL;
+    }
+
+    blink_MappedImage *res = blink_alloc(sizeof(blink_MappedImage));
+    res->map = map;
+    blink_Image *img = &res->image;
+    img->pixels = (void*) ((uint8_t*) map.data + hdr->pixels);
+    img->w = hdr->w;
+    img->h = hdr->h;
+    img->flags = (hdr->flags & BLINK_IMAGE_PREMULTIPLIED) | BLINK_IMAGE_MAPPED;
+    if (hdr->flags & BLINK_IMAGE_SPANS) {
+        int *rows = (void*) ((uint8_t*) map.data + hdr->spans);
+        uint32_t *runs = (void*) (rows + img->h + 1);
+        if (blink_check_spans(rows, runs, img->w, img->h, hdr->span_count)) {
+            img->spans = blink_alloc(sizeof(blink_Spans));
+            img->spans->rows = rows;
+            img->spans->runs = runs;
+        }
+    }
+    return img;
+}
+
+static uint32_t blink_crc32(uint32_t crc, const uint8_t *p, int n) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) { c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1; }
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    while (n--) { crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8); }
+    return ~crc;
+}
+
+static void blink_put_be32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static void blink_write_chunk(FILE *fp, const char *type, const uint8_t *data, int len) {
+    uint8_t head[8];
+    blink_put_be32(head, len);
+    memcpy(head + 4, type, 4);
+    uint32_t crc = blink_crc32(blink_crc32(0, head + 4, 4), data, len);
+    uint8_t tail[4];
+    blink_put_be32(tail, crc);
+    fwrite(head, 1, 8, fp);
+    fwrite(data, 1, len, fp);
+    fwrite(tail, 1, 4, fp);
+}
+
+bool blink_save_image(blink_Image *img, const char *filename) {
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) { return false; }
+
+    int row = img->w * 4 + 1;
+    int raw = row * img->h;
+    int blocks = (raw + 0xfffe) / 0xffff;
+    int len = 2 + blocks * 5 + raw + 4;
+    uint8_t *z = blink_alloc(len);
+    uint8_t *p = z;
+    *p++ = 0x78;
+    *p++ = 0x01;
+
+    uint32_t s1 = 1, s2 = 0;
+    int left = 0;
+    for (int i = 0; i < raw; i++) {
+        if (left == 0) {
+            left = blink_min(raw - i, 0xffff);
+            *p++ = i + left == raw;
+            *p++ = left; *p++ = left >> 8;
+            *p++ = ~left; *p++ = ~left >> 8;
+        }
+        int y = i / row, x = i % row;
+        uint8_t v = 0;
+        if (x > 0) {
+            blink_Color c = img->pixels[(x - 1) / 4 + y * img->w];
+            if ((img->flags & BLINK_IMAGE_PREMULTIPLIED) && c.a && c.a < 0xff) {
+                c = blink_rgba((c.r * 255 + c.a / 2) / c.a, (c.g * 255 + c.a / 2) / c.a, (c.b * 255 + c.a / 2) / c.a, c.a);
+            }
+            uint8_t rgba[4] = { c.r, c.g, c.b, c.a };
+            v = rgba[(x - 1) % 4];
+        }
+        *p++ = v;
+        left--;
+        s1 = (s1 + v) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    blink_put_be32(p, (s2 << 16) | s1);
+
+    uint8_t ihdr[13] = { 0 };
+    blink_put_be32(ihdr, img->w);
+    blink_put_be32(ihdr + 4, img->h);
+    ihdr[8] = 8;
+    ihdr[9] = 6;
+
+    fwrite("\x89PNG\r\n\x1a\n", 1, 8, fp);
+    blink_write_chunk(fp, "IHDR", ihdr, sizeof(ihdr));
+    blink_write_chunk(fp, "IDAT", z, len);
+    blink_write_chunk(fp, "IEND", NULL, 0);
+    free(z);
+
+    bool ok = !ferror(fp);
+    return fclose(fp) == 0 && ok;
+}
+
+int blink_compare_images(blink_Image *a, blink_Image *b, int tolerance, blink_Image *diff) {
+    if (a->w != b->w || a->h != b->h) { return -1; }
+    if (diff) { blink_expect(diff->w == a->w && diff->h == a->h); }
+    int count = 0;
+    for (int i = 0; i < a->w * a->h; i++) {
+        blink_Color x = a->pixels[i], y = b->pixels[i];
+        int d = blink_max(blink_max(abs(x.r - y.r), abs(x.g - y.g)), blink_max(abs(x.b - y.b), abs(x.a - y.a)));
+        if (d > tolerance) {
+            count++;
+            if (diff) { diff->pixels[i] = blink_rgb(0xff, 0, 0); }
+        } else if (diff) {
+            int l = (x.r * 77 + x.g * 150 + x.b * 29) >> 10;
+            diff->pixels[i] = blink_rgb(l, l, l);
+        }
+    }
+    return count;
+}
+
+typedef struct {
+    int x, y, w;
+} blink_Skyline;
+
+typedef struct {
+    blink_Image *image;
+    blink_Skyline *nodes;
+    int count;
+} blink_AtlasPage;
+
+struct blink_Atlas {
+    int w, h, flags;
+    blink_AtlasPage *pages;
+    int count, cap;
+};
+
+static int blink_skyline_fit(blink_AtlasPage *pg, int i, int w, int h) {
+    blink_Skyline *n = pg->nodes;
+    if (n[i].x + w > pg->image->w) { return -1; }
+    int y = n[i].y;
+    for (int left = w; left > 0; i++) {
+        y = blink_max(y, n[i].y);
+        if (y + h > pg->image->h) { return -1; }
+        left -= n[i].w;
+    }
+    return y;
+}
+
+static bool blink_skyline_insert(blink_AtlasPage *pg, int w, int h, blink_Rect *out) {
+    int best = -1, best_y = 0, best_w = 0;
+    for (int i = 0; i < pg->count; i++) {
+        int y = blink_skyline_fit(pg, i, w, h);
+        if (y < 0) { continue; }
+        if (best < 0 || y + h < best_y + h || (y == best_y && pg->nodes[i].w < best_w)) {
+            best = i;
+            best_y = y;
+            best_w = pg->nodes[i].w;
+        }
+    }
+    if (best < 0) { return false; }
+
+    blink_Skyline *n = pg->nodes;
+    int x = n[best].x;
+    memmove(n + best + 1, n + best, (pg->count - best) * sizeof(*n));
+    n[best] = (blink_Skyline) { x, best_y + h, w };
+    pg->count++;
+
+    int i = best + 1;
+    while (i < pg->count && n[i].x < x + w) {
+        int shrink = x + w - n[i].x;
+        if (shrink < n[i].w) {
+            n[i].x += shrink;
+            n[i].w -= shrink;
+            break;
+        }
+        memmove(n + i, n + i + 1, (pg->count - i - 1) * sizeof(*n));
+        pg->count--;
+    }
+    for (i = 0; i + 1 < pg->count; i++) {
+        if (n[i].y == n[i + 1].y) {
+            n[i].w += n[i + 1].w;
+            memmove(n + i + 1, n + i + 2, (pg->count - i - 2) * sizeof(*n));
+            pg->count--;
+            i--;
+        }
+    }
+
+    *out = blink_rect(x, best_y, w, h);
+    return true;
+}
+
+static blink_AtlasPage *blink_add_atlas_page(blink_Atlas *atlas, int w, int h) {
+    atlas->pages = blink_grow(atlas->pages, &atlas->cap, atlas->count + 1, sizeof(blink_AtlasPage));
+    blink_AtlasPage *pg = &atlas->pages[atlas->count++];
+    pg->image = blink_create_image(w, h);
+    pg->image->flags = atlas->flags;
+    pg->nodes = blink_alloc((w + 1) * sizeof(blink_Skyline));
+    pg->nodes[0] = (blink_Skyline) { 0, 0, w };
+    pg->count = 1;
+    return pg;
+}
+
+blink_Load *blink_load_image_async(blink_Context *ctx, const char *filename, int flags) {
+    blink_Loader *loader = ctx->loader;
+    if (!loader) {
+        loader = ctx->loader = blink_alloc(sizeof(blink_Loader));
+        blink_mutex_init(&loader->lock);
+        blink_cond_init(&loader->done);
+        loader->pool = blink_create_pool(blink_max(1, blink_cpu_count() / 2));
+    }
+
+    int len = strlen(filename);
+    blink_Load *load = blink_alloc(sizeof(blink_Load) + len + 1);
+    memcpy(load->filename, filename, len + 1);
+    load->loader = loader;
+    load->flags = flags;
+
+    blink_mutex_lock(&loader->lock);
+    load->next = loader->loads;
+    loader->loads = load;
+    blink_mutex_unlock(&loader->lock);
+
+    blink_pool_push(loader->pool, blink_run_load, load, 0);
+    return load;
+}
+
+bool blink_load_ready(blink_Load *load) {
+    return load->ready;
+}
+
+blink_Image *blink_finish_load(blink_Load *load) {
+    blink_Loader *loader = load->loader;
+    blink_mutex_lock(&loader->lock);
+    while (!load->decoded) {
+        blink_cond_wait(&loader->done, &loader->lock);
+    }
+    blink_Load **p = &loader->loads;
+    while (*p != load) { p = &(*p)->next; }
+    *p = load->next;
+    blink_mutex_unlock(&loader->lock);
+
+    blink_Image *img = load->image;
+    free(load);
+    return img;
+}
+
+blink_Atlas *blink_create_atlas(int width, int height, int flags) {
+    blink_expect(width > 0 && height > 0);
+    blink_Atlas *atlas = blink_alloc(sizeof(blink_Atlas));
+    atlas->w = width;
+    atlas->h = height;
+    atlas->flags = flags & BLINK_IMAGE_PREMULTIPLIED;
+    return atlas;
+}
+
+void blink_destroy_atlas(blink_Atlas *atlas) {
+    for (int i = 0; i < atlas->count; i++) {
+        blink_destroy_image(atlas->pages[i].image);
+        free(atlas->pages[i].nodes);
+    }
+    free(atlas->pages);
+    free(atlas);
+}
+
+blink_Sprite blink_atlas_add(blink_Atlas *atlas, blink_Image *img) {
+    bool premul = atlas->flags & BLINK_IMAGE_PREMULTIPLIED;
+    blink_expect(premul || !(img->flags & BLINK_IMAGE_PREMULTIPLIED));
+
+    blink_AtlasPage *pg = NULL;
+    blink_Rect r;
+    for (int i = 0; i < atlas->count && !pg; i++) {
+        if (blink_skyline_insert(&atlas->pages[i], img->w, img->h, &r)) { pg = &atlas->pages[i]; }
+    }
+    if (!pg) {
+        pg = blink_add_atlas_page(atlas, blink_max(atlas->w, img->w), blink_max(atlas->h, img->h));
+        blink_skyline_insert(pg, img->w, img->h, &r);
+    }
+
+    bool convert = premul && !(img->flags & BLINK_IMAGE_PREMULTIPLIED);
+    for (int y = 0; y < img->h; y++) {
+        blink_Color *d = &pg->image->pixels[r.x + (r.y + y) * pg->image->w];
+        blink_Color *s = &img->pixels[y * img->w];
+        if (convert) {
+            for (int x = 0; x < img->w; x++) { d[x] = blink_premul_color(s[x]); }
+        } else {
+            memcpy(d, s, img->w * sizeof(blink_Color));
+        }
+    }
+
+    return (blink_Sprite) { pg->image, r };
+}
+
+blink_Sprite blink_atlas_load_file(blink_Atlas *atlas, const char *filename) {
+    blink_Image *img = blink_load_image_file(filename);
+    if (!img) { return (blink_Sprite) { NULL }; }
+    blink_Sprite res = blink_atlas_add(atlas, img);
+    blink_destroy_image(img);
+    return res;
+}
+
+blink_Font *blink_load_font_mem(void *data, int len) {
+    return blink_load_font_from_image(blink_load_image_mem(data, len));
+}
+
+blink_Font *blink_load_font_file(const char *filename) {
+    return blink_load_font_from_image(blink_load_image_file(filename));
+}
+
+void blink_destroy_font(blink_Font *font) {
+    blink_destroy_image(font->image);
+    free(font->coverage);
+    free(font);
+}
+
+int blink_text_width(blink_Font *font, const char *text) {
+    int x = 0;
+    for (uint8_t *p = (void*) text; *p; p++) {
+        x += font->glyphs[*p].xadv;
+    }
+    return x;
+}
+
+int blink_get_char(blink_Context *ctx) {
+    for (int i = 0; i < blink_lengthof(ctx->char_buf); i++) {
+        if (!ctx->char_buf[i]) { continue; }
+        int res = ctx->char_buf[i];
+        ctx->char_buf[i] = 0;
+        return res;
+    }
+    return 0;
+}
+
+bool blink_key_down(blink_Context *ctx, int key) {
+    return blink_check_input_flag(ctx->key_state, key, sizeof(ctx->key_state), BLINK_INPUT_DOWN);
+}
+
+bool blink_key_pressed(blink_Context *ctx, int key) {
+    return blink_check_input_flag(ctx->key_state, key, sizeof(ctx->key_state), BLINK_INPUT_PRESSED);
+}
+
+bool blink_key_released(blink_Context *ctx, int key) {
+    return blink_check_input_flag(ctx->key_state, key, sizeof(ctx->key_state), BLINK_INPUT_RELEASED);
+}
+
+void blink_mouse_pos(blink_Context *ctx, int *x, int *y) {
+    if (x) { *x = ctx->mouse_pos.x; }
+    if (y) { *y = ctx->mouse_pos.y; }
+}
+
+void blink_mouse_delta(blink_Context *ctx, int *x, int *y) {
+    if (x) { *x = ctx->mouse_delta.x; }
+    if (y) { *y = ctx->mouse_delta.y; }
+}
+
+bool blink_mouse_down(blink_Context *ctx, int button) {
+    return blink_check_input_flag(ctx->mouse_state, button, sizeof(ctx->mouse_state), BLINK_INPUT_DOWN);
+}
+
+bool blink_mouse_pressed(blink_Context *ctx, int button) {
+    return blink_check_input_flag(ctx->mouse_state, button, sizeof(ctx->mouse_state), BLINK_INPUT_PRESSED);
+}
+
+bool blink_mouse_released(blink_Context *ctx, int button) {
+    return blink_check_input_flag(ctx->mouse_state, button, sizeof(ctx->mouse_state), BLINK_INPUT_RELEASED);
+}
+
+float blink_mouse_scroll(blink_Context *ctx) {
+    return ctx->mouse_scroll;
+}
+
+void blink_set_deferred(blink_Context *ctx, bool deferred) {
+    if (deferred && !ctx->commands) {
+        ctx->commands = blink_alloc(sizeof(blink_CommandBuffer));
+    }
+    if (!deferred) { blink_flush(ctx); }
+    ctx->deferred = deferred;
+}
+
+static void blink_bin_commands(blink_Context *ctx, blink_TileJob *job, bool fill) {
+    blink_CommandBuffer *cb = ctx->commands;
+    for (int i = 0; i < cb->count; i++) {
+        blink_Command *cmd = &cb->commands[i];
+        uint8_t *p = cb->data + cmd->offset;
+        for (int j = 0; j < cmd->count; j++) {
+            blink_Rect r = blink_item_bounds(cmd, p);
+            if (r.w > 0 && r.h > 0) {
+                int x1 = r.x / BLINK_TILE_SIZE, x2 = (r.x + r.w - 1) / BLINK_TILE_SIZE;
+                int y1 = r.y / BLINK_TILE_SIZE, y2 = (r.y + r.h - 1) / BLINK_TILE_SIZE;
+                for (int y = y1; y <= y2; y++) {
+                    for (int x = x1; x <= x2; x++) {
+                        int tile = x + y * job->tiles_x;
+                        if (fill) {
+                            job->items[job->tile_start[tile]++] = (blink_TileItem) { i, p - cb->data };
+                        } else {
+                            job->tile_start[tile + 1]++;
+                        }
+                    }
+                }
+            }
+            p += blink_item_size(cmd, p);
+        }
+    }
+}
+
+static void blink_flush_tiled(blink_Context *ctx) {
+    blink_CommandBuffer *cb = ctx->commands;
+    blink_TileJob job = { ctx };
+    job.tiles_x = (ctx->screen->w + BLINK_TILE_SIZE - 1) / BLINK_TILE_SIZE;
+    job.tiles_y = (ctx->screen->h + BLINK_TILE_SIZE - 1) / BLINK_TILE_SIZE;
+    int tiles = job.tiles_x * job.tiles_y;
+
+    cb->tile_start = blink_grow(cb->tile_start, &cb->tile_cap, tiles + 1, sizeof(int));
+    job.tile_start = cb->tile_start;
+    memset(job.tile_start, 0, (tiles + 1) * sizeof(int));
+    blink_bin_commands(ctx, &job, false);
+    for (int i = 0; i < tiles; i++) {
+        job.tile_start[i + 1] += job.tile_start[i];
+    }
+
+    cb->items = blink_grow(cb->items, &cb->item_cap, job.tile_start[tiles], sizeof(blink_TileItem));
+    job.items = cb->items;
+    cb->tile_stats = blink_grow(cb->tile_stats, &cb->stats_cap, tiles, sizeof(blink_Stats));
+    job.stats = cb->tile_stats;
+    memset(job.stats, 0, tiles * sizeof(blink_Stats));
+    blink_bin_commands(ctx, &job, true);
+    memmove(job.tile_start + 1, job.tile_start, tiles * sizeof(int));
+    job.tile_start[0] = 0;
+
+    for (int i = 0; i < tiles; i++) {
+        if (job.tile_start[i] != job.tile_start[i + 1]) {
+            blink_pool_push(ctx->pool, blink_run_tile, &job, i);
+        }
+    }
+    blink_pool_wait(ctx->pool);
+
+    for (int i = 0; i < tiles; i++) {
+        ctx->stats.touched += job.stats[i].touched;
+        ctx->stats.blended += job.stats[i].blended;
+        ctx->stats.copied += job.stats[i].copied;
+    }
+}
+
+void blink_flush(blink_Context *ctx) {
+    blink_CommandBuffer *cb = ctx->commands;
+    if (!cb) { return; }
+    if (ctx->pool && cb->count) {
+        blink_flush_tiled(ctx);
+    } else {
+        blink_Target t = { ctx->screen, {0}, &ctx->stats };
+        for (int i = 0; i < cb->count; i++) {
+            blink_Command *cmd = &cb->commands[i];
+            uint8_t *p = cb->data + cmd->offset;
+            t.clip = cmd->clip;
+            for (int j = 0; j < cmd->count; j++) {
+                blink_run_item(&t, cmd, p);
+                p += blink_item_size(cmd, p);
+            }
+        }
+    }
+    cb->count = 0;
+    cb->len = 0;
+}
+
+void blink_set_threads(blink_Context *ctx, int count) {
+    if (count < 1) { count = blink_cpu_count(); }
+    blink_flush(ctx);
+    blink_destroy_pool(ctx->pool);
+    ctx->pool = NULL;
+    if (count > 1) {
+        ctx->pool = blink_create_pool(count - 1);
+        blink_set_deferred(ctx, true);
+    }
+}
+
+void blink_set_profiling(blink_Context *ctx, bool enabled) {
+    if (enabled && !ctx->profiler) {
+        ctx->profiler = blink_alloc(sizeof(blink_Profiler));
+        ctx->profiler->start[0] = blink_platform_time();
+    } else if (!enabled) {
+        free(ctx->profiler);
+        ctx->profiler = NULL;
+    }
+}
+
+void blink_profile_begin(blink_Context *ctx, const char *name) {
+    blink_Profiler *p = ctx->profiler;
+    if (!p) { return; }
+    int idx = -1;
+    if (p->count[p->frame] < BLINK_PROFILE_SCOPES) {
+        idx = p->count[p->frame]++;
+        p->scopes[p->frame][idx] = (blink_Scope) { name, blink_platform_time(), 0, p->depth, 1 };
+    }
+    if (p->depth < BLINK_PROFILE_DEPTH) { p->stack[p->depth] = idx; }
+    p->depth++;
+}
+
+void blink_profile_end(blink_Context *ctx) {
+    blink_Profiler *p = ctx->profiler;
+    if (!p || p->depth == 0) { return; }
+    p->depth--;
+    if (p->depth < BLINK_PROFILE_DEPTH && p->stack[p->depth] >= 0) {
+        blink_Scope *s = &p->scopes[p->frame][p->stack[p->depth]];
+        s->time = blink_platform_time() - s->start;
+    }
+}
+
+void blink_draw_profile(blink_Context *ctx, int x, int y) {
+    blink_Profiler *p = ctx->profiler;
+    if (!p) { return; }
+    ctx->profiler = NULL;
+
+    int w = BLINK_PROFILE_FRAMES * 2;
+    int h = 64;
+    double scale = h / (2.0 / 60.0);
+    blink_draw_rect(ctx, blink_rect(x, y, w, h), blink_rgba(0, 0, 0, 0xc0));
+    blink_draw_rect(ctx, blink_rect(x, y + h - (int) (scale / 60.0), w, 1), blink_rgba(0xff, 0xff, 0xff, 0x40));
+
+    for (int i = 0; i < p->frames; i++) {
+        int f = (p->frame - p->frames + i + BLINK_PROFILE_FRAMES) % BLINK_PROFILE_FRAMES;
+        int bx = x + (BLINK_PROFILE_FRAMES - p->frames + i) * 2;
+        double t = 0;
+        for (int j = 0; j < p->count[f]; j++) {
+            blink_Scope *s = &p->scopes[f][j];
+            if (s->depth > 0) { continue; }
+            int y1 = y + h - blink_min((int) (t * scale), h);
+            t += s->time;
+            int y2 = y + h - blink_min((int) (t * scale), h);
+            blink_draw_rect(ctx, blink_rect(bx, y2, 2, y1 - y2), blink_profile_color(s->name));
+        }
+        int y1 = y + h - blink_min((int) (t * scale), h);
+        int y2 = y + h - blink_min((int) (p->time[f] * scale), h);
+        blink_draw_rect(ctx, blink_rect(bx, y2, 2, y1 - y2), blink_rgb(0x60, 0x60, 0x60));
+    }
+
+    if (p->frames > 0) {
+        int f = (p->frame + BLINK_PROFILE_FRAMES - 1) % BLINK_PROFILE_FRAMES;
+        const char *names[BLINK_PROFILE_SCOPES];
+        double times[BLINK_PROFILE_SCOPES];
+        int n = 0;
+        for (int j = 0; j < p->count[f]; j++) {
+            blink_Scope *s = &p->scopes[f][j];
+            if (s->depth > 0) { continue; }
+            int k = 0;
+            while (k < n && strcmp(names[k], s->name)) { k++; }
+            if (k == n) { names[n] = s->name; times[n++] = 0; }
+            times[k] += s->time;
+        }
+
+        char buf[64];
+        int lh = ctx->font->image->h / 16;
+        int ty = y + h + 2;
+        snprintf(buf, sizeof(buf), "frame %.2f ms", p->time[f] * 1000.0);
+        blink_draw_text(ctx, buf, x, ty, BLINK_WHITE);
+        for (int k = 0; k < n; k++) {
+            ty += lh;
+            snprintf(buf, sizeof(buf), "%s %.2f ms", names[k], times[k] * 1000.0);
+            blink_draw_rect(ctx, blink_rect(x, ty + 1, lh - 2, lh - 2), blink_profile_color(names[k]));
+            blink_draw_text(ctx, buf, x + lh, ty, BLINK_WHITE);
+        }
+    }
+
+    ctx->profiler = p;
+}
+
+static void blink_write_json_string(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (const uint8_t *p = (const void*) s; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(fp, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(fp, "\\u%04x", *p);
+        } else {
+            fputc(*p, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+bool blink_save_profile(blink_Context *ctx, const char *filename) {
+    blink_Profiler *p = ctx->profiler;
+    if (!p) { return false; }
+    FILE *fp = fopen(filename, "w");
+    if (!fp) { return false; }
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    const char *sep = "";
+    for (int i = 0; i < p->frames; i++) {
+        int f = (p->frame - p->frames + i + BLINK_PROFILE_FRAMES) % BLINK_PROFILE_FRAMES;
+        fprintf(fp, "%s{\"name\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+            sep, p->start[f] * 1e6, p->time[f] * 1e6);
+        sep = ",\n";
+        for (int j = 0; j < p->count[f]; j++) {
+            blink_Scope *s = &p->scopes[f][j];
+            fprintf(fp, "%s{\"name\":", sep);
+            blink_write_json_string(fp, s->name);
+            fprintf(fp, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"calls\":%d}}",
+                s->start * 1e6, s->time * 1e6, s->calls);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    return true;
+}
+
+void blink_clear(blink_Context *ctx, blink_Color color) {
+    blink_profile_begin(ctx, "clear");
+    blink_draw_rect(ctx, blink_rect(0, 0, ctx->screen->w, ctx->screen->h), color);
+    blink_profile_end(ctx);
+}
+
+void blink_set_clip(blink_Context *ctx, blink_Rect rect) {
+    blink_Rect screen_rect = blink_rect(0, 0, ctx->screen->w, ctx->screen->h);
+    ctx->clip = blink_intersect_rects(rect, screen_rect);
+}
+
+static void blink_submit_rect(blink_Context *ctx, blink_Rect rect, blink_Color color) {
+    if (color.a == 0 || rect.w <= 0 || rect.h <= 0) { return; }
+    ctx->stats.clipped += blink_clipped_area(ctx, rect);
+    blink_Rect r = blink_intersect_rects(rect, ctx->clip);
+    if (r.w <= 0 || r.h <= 0) { return; }
+    blink_mark_dirty(ctx, r);
+    if (!ctx->deferred) {
+        blink_Target t = blink_screen_target(ctx);
+        blink_raster_rect(&t, r, color);
+        return;
+    }
+    if (color.a == 0xff && r.w == ctx->screen->w && r.h == ctx->screen->h) {
+        ctx->commands->count = 0;
+        ctx->commands->len = 0;
+    }
+    *(blink_Rect*) blink_push_command(ctx, BLINK_COMMAND_RECT, NULL, color, BLINK_BLACK, sizeof(r)) = r;
+}
+
+void blink_draw_rect(blink_Context *ctx, blink_Rect rect, blink_Color color) {
+    double t = blink_profile_now(ctx);
+    ctx->stats.rect_calls++;
+    blink_submit_rect(ctx, rect, color);
+    blink_profile_draw(ctx, t);
+}
+
+void blink_draw_point(blink_Context *ctx, int x, int y, blink_Color color) {
+    double t = blink_profile_now(ctx);
+    ctx->stats.point_calls++;
+    blink_submit_rect(ctx, blink_rect(x, y, 1, 1), color);
+    blink_profile_draw(ctx, t);
+}
+
+static void blink_submit_line(blink_Context *ctx, int x1, int y1, int x2, int y2, blink_Color color) {
+    if (color.a == 0) { return; }
+    blink_Rect bounds = blink_rect(blink_min(x1, x2), blink_min(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1);
+    if (blink_is_culled(ctx, bounds)) {
+        ctx->stats.clipped += blink_max(bounds.w, bounds.h);
+        return;
+    }
+    if (blink_clipped_area(ctx, bounds)) {
+        ctx->stats.clipped += blink_clipped_line(ctx, x1, y1, x2, y2);
+    }
+    blink_mark_dirty(ctx, bounds);
+    if (!ctx->deferred) {
+        blink_Target t = blink_screen_target(ctx);
+        blink_raster_line(&t, x1, y1, x2, y2, color);
+        return;
+    }
+    blink_LineItem *l = blink_push_command(ctx, BLINK_COMMAND_LINE, NULL, color, BLINK_BLACK, sizeof(*l));
+    *l = (blink_LineItem) { x1, y1, x2, y2 };
+}
+
+void blink_draw_line(blink_Context *ctx, int x1, int y1, int x2, int y2, blink_Color color) {
+    double t = blink_profile_now(ctx);
+    ctx->stats.line_calls++;
+    blink_submit_line(ctx, x1, y1, x2, y2, color);
+    blink_profile_draw(ctx, t);
+}
+
+void blink_draw_image(blink_Context *ctx, blink_Image *img, int x, int y) {
+    blink_Rect dst = blink_rect(x, y, img->w, img->h);
+    blink_Rect src = blink_rect(0, 0, img->w, img->h);
+    blink_draw_image3(ctx, img, dst, src, BLINK_WHITE, BLINK_BLACK);
+}
+
+void blink_draw_image2(blink_Context *ctx, blink_Image *img, int x, int y, blink_Rect src, blink_Color color) {
+    blink_Rect dst = blink_rect(x, y, abs(src.w), abs(src.h));
+    blink_draw_image3(ctx, img, dst, src, color, BLINK_BLACK);
+}
+
+static void blink_submit_image(blink_Context *ctx, blink_Image *img, blink_Rect dst, blink_Rect src, blink_Color mul_color, blink_Color add_color) {
+    if (!src.w || !src.h || dst.w <= 0 || dst.h <= 0) { return; }
+    ctx->stats.clipped += blink_clipped_area(ctx, dst);
+    if (blink_is_culled(ctx, dst)) { return; }
+    blink_mark_dirty(ctx, dst);
+    if (!ctx->deferred) {
+        blink_Target t = blink_screen_target(ctx);
+        blink_raster_image(&t, img, dst, src, mul_color, add_color);
+        return;
+    }
+    blink_ImageItem *im = blink_push_command(ctx, BLINK_COMMAND_IMAGE, img, mul_color, add_color, sizeof(*im));
+    *im = (blink_ImageItem) { dst, src };
+}
+
+void blink_draw_image3(blink_Context *ctx, blink_Image *img, blink_Rect dst, blink_Rect src, blink_Color mul_color, blink_Color add_color) {
+    double t = blink_profile_now(ctx);
+    ctx->stats.image_calls++;
+    blink_submit_image(ctx, img, dst, src, mul_color, add_color);
+    blink_profile_draw(ctx, t);
+}
+
+int blink_draw_text(blink_Context *ctx, const char *text, int x, int y, blink_Color color) {
+    return blink_draw_text2(ctx, ctx->font, text, x, y, color);
+}
+
+static int blink_submit_text(blink_Context *ctx, blink_Font *font, const char *text, int x, int y, blink_Color color) {
+    int h = font->image->h / 16;
+    if (!ctx->deferred) {
+        blink_Target t = blink_screen_target(ctx);
+        int end = blink_raster_text(&t, font, text, x, y, color);
+        blink_Rect bounds = blink_rect(x, y, end - x, h);
+        if (!blink_is_culled(ctx, bounds)) { ctx->stats.glyphs += strlen(text); }
+        ctx->stats.clipped += blink_clipped_area(ctx, bounds);
+        blink_mark_dirty(ctx, bounds);
+        return end;
+    }
+    int w = blink_text_width(font, text);
+    blink_Rect bounds = blink_rect(x, y, w, h);
+    ctx->stats.clipped += blink_clipped_area(ctx, bounds);
+    if (!blink_is_culled(ctx, bounds)) {
+        blink_mark_dirty(ctx, bounds);
+        int len = strlen(text);
+        ctx->stats.glyphs += len;
+        blink_TextItem *tx = blink_push_command(ctx, BLINK_COMMAND_TEXT, font, color, BLINK_BLACK, sizeof(*tx) + len + 1);
+        *tx = (blink_TextItem) { x, y, len };
+        memcpy(tx + 1, text, len + 1);
+    }
+    return x + w;
+}
+
+int blink_draw_text2(blink_Context *ctx, blink_Font *font, const char *text, int x, int y, blink_Color color) {
+    double t = blink_profile_now(ctx);
+    ctx->stats.text_calls++;
+    int res = blink_submit_text(ctx, font, text, x, y, color);
+    blink_profile_draw(ctx, t);
+    return res;
+}
+
+bool blink_open_audio(blink_Context *ctx, int flags) {
+    if (ctx->audio) { return true; }
+    blink_Audio *a = blink_alloc(sizeof(blink_Audio));
+    blink_mutex_init(&a->lock);
+    blink_cond_init(&a->wake);
+    a->music_volume = 1;
+    blink_init_queue(&a->commands, sizeof(blink_VoiceCommand), BLINK_VOICE_COMMANDS);
+    blink_init_queue(&a->finished, sizeof(blink_Voice), BLINK_VOICE_FINISHED);
+    if (ma_pcm_rb_init(ma_format_f32, BLINK_AUDIO_CHANNELS, BLINK_MUSIC_RING, NULL, NULL, &a->ring) != MA_SUCCESS) {
+        blink_panic("failed to create audio ring buffer");
+    }
+    if (!(flags & BLINK_AUDIO_OFFLINE) && !blink_start_audio_device(a, flags)) {
+        blink_close_audio(a);
+        return false;
+    }
+    ctx->audio = a;
+    return true;
+}
+
+void blink_render_audio(blink_Context *ctx, float *out, int frames) {
+    blink_Audio *a = ctx->audio;
+    if (!a || a->has_device) {
+        memset(out, 0, frames * BLINK_AUDIO_CHANNELS * sizeof(float));
+        return;
+    }
+    while (frames > 0) {
+        int n = blink_min(frames, BLINK_MUSIC_RING / 2);
+        blink_sync_flush(a);
+        blink_mutex_lock(&a->lock);
+        blink_stream_music(a);
+        blink_mutex_unlock(&a->lock);
+        blink_mix_audio(a, out, n);
+        out += n * BLINK_AUDIO_CHANNELS;
+        frames -= n;
+    }
+}
+
+blink_Music *blink_load_music(blink_Context *ctx, const char *filename) {
+    if (!ctx->audio) { return NULL; }
+    blink_File *f = blink_open_file(filename);
+    if (!f) { return NULL; }
+    int err;
+    stb_vorbis *v = stb_vorbis_open_memory(f->data, f->size, &err, NULL);
+    if (!v) {
+        blink_close_file(f);
+        return NULL;
+    }
+
+    stb_vorbis_info info = stb_vorbis_get_info(v);
+    blink_Music *m = blink_alloc(sizeof(blink_Music) + BLINK_MUSIC_CHUNK * info.channels * sizeof(float));
+    ma_data_converter_config cfg = ma_data_converter_config_init(
+        ma_format_f32, ma_format_f32, info.channels, BLINK_AUDIO_CHANNELS, info.sample_rate, BLINK_AUDIO_RATE);
+    if (ma_data_converter_init(&cfg, NULL, &m->converter) != MA_SUCCESS) {
+        stb_vorbis_close(v);
+        blink_close_file(f);
+        free(m);
+        return NULL;
+    }
+    m->audio = ctx->audio;
+    m->file = f;
+    m->vorbis = v;
+    m->channels = info.channels;
+    m->buf = (void*) (m + 1);
+    return m;
+}
+
+void blink_destroy_music(blink_Music *music) {
+    blink_Audio *a = music->audio;
+    blink_mutex_lock(&a->lock);
+    bool playing = a->music == music;
+    blink_mutex_unlock(&a->lock);
+    if (playing) { blink_set_music(a, NULL, false); }
+    ma_data_converter_uninit(&music->converter, NULL);
+    stb_vorbis_close(music->vorbis);
+    blink_close_file(music->file);
+    free(music);
+}
+
+void blink_play_music(blink_Context *ctx, blink_Music *music, bool loop) {
+    if (ctx->audio) { blink_set_music(ctx->audio, music, loop); }
+}
+
+void blink_stop_music(blink_Context *ctx) {
+    if (ctx->audio) { blink_set_music(ctx->audio, NULL, false); }
+}
+
+bool blink_music_playing(blink_Context *ctx) {
+    blink_Audio *a = ctx->audio;
+    if (!a) { return false; }
+    blink_mutex_lock(&a->lock);
+    bool res = a->music != NULL;
+    /* after the decoder hits the end the ring still holds the tail; a
+     * pending flush means it was stopped and will be dropped instead */
+    if (!res && blink_atomic_load(&a->flush_ack) == a->flush) {
+        res = ma_pcm_rb_available_read(&a->ring) > 0;
+    }
+    blink_mutex_unlock(&a->lock);
+    return res;
+}
+
+void blink_set_music_volume(blink_Context *ctx, float volume) {
+    if (ctx->audio) { blink_store_float(&ctx->audio->music_volume, volume); }
+}
+
+blink_Sound *blink_create_sound(const float *samples, int frames, int channels) {
+    if (frames <= 0 || channels < 1 || channels > 2) { return NULL; }
+    blink_Sound *sound = blink_alloc_sound(frames, channels);
+    memcpy(sound->samples, samples, frames * channels * sizeof(float));
+    return sound;
+}
+
+blink_Sound *blink_load_sound_mem(void *data, int len) {
+    int err;
+    stb_vorbis *v = stb_vorbis_open_memory(data, len, &err, NULL);
+    if (!v) { return NULL; }
+    stb_vorbis_info info = stb_vorbis_get_info(v);
+    int channels = blink_min(info.channels, 2);
+    int frames = stb_vorbis_stream_length_in_samples(v);
+    if (frames <= 0) {
+        stb_vorbis_close(v);
+        return NULL;
+    }
+
+    bool convert = info.sample_rate != BLINK_AUDIO_RATE;
+    blink_Sound *sound = convert ? NULL : blink_alloc_sound(frames, channels);
+    float *pcm = convert ? blink_alloc(frames * channels * sizeof(float)) : sound->samples;
+    int got = 0;
+    while (got < frames) {
+        int n = stb_vorbis_get_samples_float_interleaved(v, channels, pcm + got * channels, (frames - got) * channels);
+        if (n == 0) { break; }
+        got += n;
+    }
+    stb_vorbis_close(v);
+
+    if (convert) {
+        ma_uint64 n = ma_convert_frames(NULL, 0, ma_format_f32, channels, BLINK_AUDIO_RATE,
+            pcm, got, ma_format_f32, channels, info.sample_rate);
+        if (n > 0) {
+            sound = blink_alloc_sound(n, channels);
+            sound->frames = ma_convert_frames(sound->samples, n, ma_format_f32, channels, BLINK_AUDIO_RATE,
+                pcm, got, ma_format_f32, channels, info.sample_rate);
+        }
+        free(pcm);
+    } else {
+        sound->frames = got;
+    }
+    if (sound && sound->frames == 0) {
+        free(sound);
+        return NULL;
+    }
+    return sound;
+}
+
+blink_Sound *blink_load_sound_file(const char *filename) {
+    blink_File *f = blink_open_file(filename);
+    if (!f) { return NULL; }
+    blink_Sound *sound = blink_load_sound_mem((void*) f->data, f->size);
+    blink_close_file(f);
+    return sound;
+}
+
+blink_Sound *blink_retain_sound(blink_Sound *sound) {
+    sound->refs++;
+    return sound;
+}
+
+void blink_destroy_sound(blink_Sound *sound) {
+    blink_release_sound(sound);
+}
+
+uint32_t blink_play_sound(blink_Context *ctx, blink_Sound *sound) {
+    return blink_play_sound2(ctx, sound, 1, 0, 1, 0, false);
+}
+
+uint32_t blink_play_sound2(blink_Context *ctx, blink_Sound *sound, float gain, float pan, float pitch, int priority, bool loop) {
+    blink_Audio *a = ctx->audio;
+    if (!a || !sound) { return 0; }
+    blink_reap_voices(a);
+
+    int slot = -1;
+    for (int i = 0; i < BLINK_MAX_VOICES; i++) {
+        if (!a->slots[i].id) {
+            slot = i;
+            break;
+        }
+        if (a->slots[i].priority > priority) { continue; }
+        if (slot < 0 || a->slots[i].priority < a->slots[slot].priority ||
+            (a->slots[i].priority == a->slots[slot].priority && (int32_t) (a->slots[i].seq - a->slots[slot].seq) < 0)) {
+            slot = i;
+        }
+    }
+    if (slot < 0) { return 0; }
+
+    uint32_t seq = ++a->seq;
+    blink_VoiceCommand cmd = { BLINK_VOICE_PLAY };
+    cmd.voice.sound = sound;
+    cmd.voice.id = (seq << 8) | (slot + 1);
+    blink_set_voice_params(&cmd.voice, gain, pan, pitch);
+    cmd.voice.loop = loop;
+    if (!blink_queue_push(&a->commands, &cmd)) { return 0; }
+
+    a->slots[slot].id = cmd.voice.id;
+    a->slots[slot].seq = seq;
+    a->slots[slot].priority = priority;
+    blink_retain_sound(sound);
+    return cmd.voice.id;
+}
+
+void blink_set_voice(blink_Context *ctx, uint32_t voice, float gain, float pan, float pitch) {
+    if (!ctx->audio || !blink_valid_voice(voice)) { return; }
+    blink_VoiceCommand cmd = { BLINK_VOICE_SET };
+    cmd.voice.id = voice;
+    blink_set_voice_params(&cmd.voice, gain, pan, pitch);
+    blink_queue_push(&ctx->audio->commands, &cmd);
+}
+
+void blink_stop_voice(blink_Context *ctx, uint32_t voice) {
+    if (!ctx->audio || !blink_valid_voice(voice)) { return; }
+    blink_VoiceCommand cmd = { BLINK_VOICE_STOP };
+    cmd.voice.id = voice;
+    blink_queue_push(&ctx->audio->commands, &cmd);
+}
+
+bool blink_voice_playing(blink_Context *ctx, uint32_t voice) {
+    blink_Audio *a = ctx->audio;
+    if (!a || !blink_valid_voice(voice)) { return false; }
+    blink_reap_voices(a);
+    return a->slots[(voice & 0xff) - 1].id == voice;
+}
+
+struct blink_Script {
+    blink_Context *ctx;
+    char dir[512];
+    WrenVM *vm;
+    WrenHandle *game, *update, *draw;
+};
+
+static const char blink_wren_module[] =
+    "foreign class Image {\n"
+    "  construct load(path) {}\n"
+    "  foreign width\n"
+    "  foreign height\n"
+    "}\n"
+    "\n"
+    "foreign class Font {\n"
+    "  construct load(path) {}\n"
+    "  foreign width(text)\n"
+    "}\n"
+    "\n"
+    "class Color {\n"
+    "  static rgb(r, g, b) { rgba(r, g, b, 255) }\n"
+    "  static rgba(r, g, b, a) { ((a * 256 + r) * 256 + g) * 256 + b }\n"
+    "}\n"
+    "\n"
+    "class Draw {\n"
+    "  foreign static width\n"
+    "  foreign static height\n"
+    "  foreign static clear(color)\n"
+    "  foreign static clip(x, y, w, h)\n"
+    "  foreign static point(x, y, color)\n"
+    "  foreign static rect(x, y, w, h, color)\n"
+    "  foreign static line(x1, y1, x2, y2, color)\n"
+    "  foreign static image(image, x, y)\n"
+    "  foreign static image(image, x, y, sx, sy, sw, sh, color)\n"
+    "  foreign static text(text, x, y, color)\n"
+    "  foreign static text(font, text, x, y, color)\n"
+    "}\n"
+    "\n"
+    "class Input {\n"
+    "  foreign static keyDown(key)\n"
+    "  foreign static keyPressed(key)\n"
+    "  foreign static keyReleased(key)\n"
+    "  foreign static mouseDown(button)\n"
+    "  foreign static mousePressed(button)\n"
+    "  foreign static mouseReleased(button)\n"
+    "  foreign static mouseX\n"
+    "  foreign static mouseY\n"
+    "  foreign static mouseScroll\n"
+    "}\n";
+
+enum { BLINK_WREN_IMAGE = 1, BLINK_WREN_FONT };
+
+#define BLINK_WREN_MAX_INT (1 << 24)
+
+typedef struct {
+    int kind;
+    void *ptr;
+    blink_Context *ctx;
+} blink_WrenObject;
+
+static blink_Context *blink_wren_ctx(WrenVM *vm) {
+    return ((blink_Script*) wrenGetUserData(vm))->ctx;
+}
+
+static bool blink_wren_fail(WrenVM *vm, const char *msg) {
+    wrenSetSlotString(vm, 0, msg);
+    wrenAbortFiber(vm, 0);
+    return false;
+}
+
+static bool blink_wren_nums(WrenVM *vm, int first, int last) {
+    for (int i = first; i <= last; i++) {
+        if (wrenGetSlotType(vm, i) != WREN_TYPE_NUM || !isfinite(wrenGetSlotDouble(vm, i))) {
+            return blink_wren_fail(vm, "expected a number");
+        }
+    }
+    return true;
+}
+
+static bool blink_wren_string(WrenVM *vm, int slot) {
+    if (wrenGetSlotType(vm, slot) != WREN_TYPE_STRING) { return blink_wren_fail(vm, "expected a string"); }
+    return true;
+}
+
+static void *blink_wren_object(WrenVM *vm, int slot, int kind) {
+    if (wrenGetSlotType(vm, slot) == WREN_TYPE_FOREIGN) {
+        blink_WrenObject *obj = wrenGetSlotForeign(vm, slot);
+        if (obj->kind == kind && obj->ptr) { return obj->ptr; }
+    }
+    blink_wren_fail(vm, kind == BLINK_WREN_IMAGE ? "expected an Image" : "expected a Font");
+    return NULL;
+}
+
+static int blink_wren_int(WrenVM *vm, int slot) {
+    double d = wrenGetSlotDouble(vm, slot);
+    if (isnan(d)) { return 0; }
+    return (int) blink_max(-BLINK_WREN_MAX_INT, blink_min(d, BLINK_WREN_MAX_INT));
+}
+
+static blink_Color blink_wren_color(WrenVM *vm, int slot) {
+    double d = wrenGetSlotDouble(vm, slot);
+    blink_Color c;
+    c.w = isnan(d) ? 0 : (uint32_t) blink_max(0, blink_min(d, UINT32_MAX));
+    return c;
+}
+
+static bool blink_wren_key(WrenVM *vm, int slot, int *key) {
+    if (wrenGetSlotType(vm, slot) == WREN_TYPE_STRING) {
+        const char *s = wrenGetSlotString(vm, slot);
+        *key = (s[0] >= 'a' && s[0] <= 'z') ? s[0] - 'a' + 'A' : (uint8_t) s[0];
+        return true;
+    }
+    if (!blink_wren_nums(vm, slot, slot)) { return false; }
+    *key = blink_wren_int(vm, slot);
+    return true;
+}
+
+static void blink_wren_alloc(WrenVM *vm, int kind) {
+    blink_WrenObject *obj = wrenSetSlotNewForeign(vm, 0, 0, sizeof(blink_WrenObject));
+    obj->kind = kind;
+    obj->ptr = NULL;
+    obj->ctx = blink_wren_ctx(vm);
+    if (wrenGetSlotType(vm, 1) != WREN_TYPE_STRING) {
+        blink_wren_fail(vm, "expected a path");
+        return;
+    }
+    const char *path = wrenGetSlotString(vm, 1);
+    if (kind == BLINK_WREN_IMAGE) {
+        obj->ptr = blink_load_image_file(path);
+    } else {
+        obj->ptr = blink_load_font_file(path);
+    }
+    if (!obj->ptr) { blink_wren_fail(vm, kind == BLINK_WREN_IMAGE ? "failed to load image" : "failed to load font"); }
+}
+
+static void blink_wren_image_alloc(WrenVM *vm) {
+    blink_wren_alloc(vm, BLINK_WREN_IMAGE);
+}
+
+static void blink_wren_font_alloc(WrenVM *vm) {
+    blink_wren_alloc(vm, BLINK_WREN_FONT);
+}
+
+static void blink_wren_free(void *data) {
+    blink_WrenObject *obj = data;
+    if (!obj->ptr) { return; }
+    /* deferred commands may still point at the image */
+    if (obj->ctx->commands && obj->ctx->commands->count) { blink_flush(obj->ctx); }
+    if (obj->kind == BLINK_WREN_IMAGE) {
+        blink_destroy_image(obj->ptr);
+    } else {
+        blink_destroy_font(obj->ptr);
+    }
+}
+
+static void blink_wren_image_width(WrenVM *vm) {
+    blink_Image *img = blink_wren_object(vm, 0, BLINK_WREN_IMAGE);
+    if (img) { wrenSetSlotDouble(vm, 0, img->w); }
+}
+
+static void blink_wren_image_height(WrenVM *vm) {
+    blink_Image *img = blink_wren_object(vm, 0, BLINK_WREN_IMAGE);
+    if (img) { wrenSetSlotDouble(vm, 0, img->h); }
+}
+
+static void blink_wren_font_width(WrenVM *vm) {
+    blink_Font *font = blink_wren_object(vm, 0, BLINK_WREN_FONT);
+    if (!font || !blink_wren_string(vm, 1)) { return; }
+    wrenSetSlotDouble(vm, 0, blink_text_width(font, wrenGetSlotString(vm, 1)));
+}
+
+static void blink_wren_width(WrenVM *vm) {
+    wrenSetSlotDouble(vm, 0, blink_wren_ctx(vm)->screen->w);
+}
+
+static void blink_wren_height(WrenVM *vm) {
+    wrenSetSlotDouble(vm, 0, blink_wren_ctx(vm)->screen->h);
+}
+
+static void blink_wren_clear(WrenVM *vm) {
+    if (!blink_wren_nums(vm, 1, 1)) { return; }
+    blink_clear(blink_wren_ctx(vm), blink_wren_color(vm, 1));
+}
+
+static void blink_wren_clip(WrenVM *vm) {
+    if (!blink_wren_nums(vm, 1, 4)) { return; }
+    blink_Rect r = blink_rect(blink_wren_int(vm, 1), blink_wren_int(vm, 2), blink_wren_int(vm, 3), blink_wren_int(vm, 4));
+    blink_set_clip(blink_wren_ctx(vm), r);
+}
+
+static void blink_wren_point(WrenVM *vm) {
+    if (!blink_wren_nums(vm, 1, 3)) { return; }
+    blink_draw_point(blink_wren_ctx(vm), blink_wren_int(vm, 1), blink_wren_int(vm, 2), blink_wren_color(vm, 3));
+}
+
+static void blink_wren_rect(WrenVM *vm) {
+    if (!blink_wren_nums(vm, 1, 5)) { return; }
+    blink_Rect r = blink_rect(blink_wren_int(vm, 1), blink_wren_int(vm, 2), blink_wren_int(vm, 3), blink_wren_int(vm, 4));
+    blink_draw_rect(blink_wren_ctx(vm), r, blink_wren_color(vm, 5));
+}
+
+static void blink_wren_line(WrenVM *vm) {
+    if (!blink_wren_nums(vm, 1, 5)) { return; }
+    blink_draw_line(blink_wren_ctx(vm), blink_wren_int(vm, 1), blink_wren_int(vm, 2),
+        blink_wren_int(vm, 3), blink_wren_int(vm, 4), blink_wren_color(vm, 5));
+}
+
+static void blink_wren_image(WrenVM *vm) {
+    blink_Image *img = blink_wren_object(vm, 1, BLINK_WREN_IMAGE);
+    if (!img || !blink_wren_nums(vm, 2, 3)) { return; }
+    blink_draw_image(blink_wren_ctx(vm), img, blink_wren_int(vm, 2), blink_wren_int(vm, 3));
+}
+
+static void blink_wren_image2(WrenVM *vm) {
+    blink_Image *img = blink_wren_object(vm, 1, BLINK_WREN_IMAGE);
+    if (!img || !blink_wren_nums(vm, 2, 8)) { return; }
+    blink_Rect src = blink_rect(blink_wren_int(vm, 4), blink_wren_int(vm, 5), blink_wren_int(vm, 6), blink_wren_int(vm, 7));
+    blink_Rect r = blink_intersect_rects(src, blink_rect(0, 0, img->w, img->h));
+    if (r.w <= 0 || r.h <= 0 || memcmp(&r, &src, sizeof(r))) {
+        blink_wren_fail(vm, "source rect outside image");
+        return;
+    }
+    blink_draw_image2(blink_wren_ctx(vm), img, blink_wren_int(vm, 2), blink_wren_int(vm, 3), src, blink_wren_color(vm, 8));
+}
+
+static void blink_wren_text(WrenVM *vm) {
+    if (!blink_wren_string(vm, 1) || !blink_wren_nums(vm, 2, 4)) { return; }
+    int w = blink_draw_text(blink_wren_ctx(vm), wrenGetSlotString(vm, 1), blink_wren_int(vm, 2), blink_wren_int(vm, 3), blink_wren_color(vm, 4));
+    wrenSetSlotDouble(vm, 0, w);
+}
+
+static void blink_wren_text2(WrenVM *vm) {
+    blink_Font *font = blink_wren_object(vm, 1, BLINK_WREN_FONT);
+    if (!font || !blink_wren_string(vm, 2) || !blink_wren_nums(vm, 3, 5)) { return; }
+    int w = blink_draw_text2(blink_wren_ctx(vm), font, wrenGetSlotString(vm, 2), blink_wren_int(vm, 3), blink_wren_int(vm, 4), blink_wren_color(vm, 5));
+    wrenSetSlotDouble(vm, 0, w);
+}
+
+static void blink_wren_key_down(WrenVM *vm) {
+    int key;
+    if (blink_wren_key(vm, 1, &key)) { wrenSetSlotBool(vm, 0, blink_key_down(blink_wren_ctx(vm), key)); }
+}
+
+static void blink_wren_key_pressed(WrenVM *vm) {
+    int key;
+    if (blink_wren_key(vm, 1, &key)) { wrenSetSlotBool(vm, 0, blink_key_pressed(blink_wren_ctx(vm), key)); }
+}
+
+static void blink_wren_key_released(WrenVM *vm) {
+    int key;
+    if (blink_wren_key(vm, 1, &key)) { wrenSetSlotBool(vm, 0, blink_key_released(blink_wren_ctx(vm), key)); }
+}
+
+static void blink_wren_mouse_down(WrenVM *vm) {
+    if (!blink_wren_nums(vm, 1, 1)) { return; }
+    wrenSetSlotBool(vm, 0, blink_mouse_down(blink_wren_ctx(vm), blink_wren_int(vm, 1)));
+}
+
+static void blink_wren_mouse_pressed(WrenVM *vm) {
+    if (!blink_wren_nums(vm, 1, 1)) { return; }
+    wrenSetSlotBool(vm, 0, blink_mouse_pressed(blink_wren_ctx(vm), blink_wren_int(vm, 1)));
+}
+
+static void blink_wren_mouse_released(WrenVM *vm) {
+    if (!blink_wren_nums(vm, 1, 1)) { return; }
+    wrenSetSlotBool(vm, 0, blink_mouse_released(blink_wren_ctx(vm), blink_wren_int(vm, 1)));
+}
+
+static void blink_wren_mouse_x(WrenVM *vm) {
+    int x, y;
+    blink_mouse_pos(blink_wren_ctx(vm), &x, &y);
+    wrenSetSlotDouble(vm, 0, x);
+}
+
+static void blink_wren_mouse_y(WrenVM *vm) {
+    int x, y;
+    blink_mouse_pos(blink_wren_ctx(vm), &x, &y);
+    wrenSetSlotDouble(vm, 0, y);
+}
+
+static void blink_wren_mouse_scroll(WrenVM *vm) {
+    wrenSetSlotDouble(vm, 0, blink_mouse_scroll(blink_wren_ctx(vm)));
+}
+
+static const struct {
+    const char *class_name;
+    bool is_static;
+    const char *signature;
+    WrenForeignMethodFn fn;
+} blink_wren_methods[] = {
+    { "Image", false, "width", blink_wren_image_width },
+    { "Image", false, "height", blink_wren_image_height },
+    { "Font", false, "width(_)", blink_wren_font_width },
+    { "Draw", true, "width", blink_wren_width },
+    { "Draw", true, "height", blink_wren_height },
+    { "Draw", true, "clear(_)", blink_wren_clear },
+    { "Draw", true, "clip(_,_,_,_)", blink_wren_clip },
+    { "Draw", true, "point(_,_,_)", blink_wren_point },
+    { "Draw", true, "rect(_,_,_,_,_)", blink_wren_rect },
+    { "Draw", true, "line(_,_,_,_,_)", blink_wren_line },
+    { "Draw", true, "image(_,_,_)", blink_wren_image },
+    { "Draw", true, "image(_,_,_,_,_,_,_,_)", blink_wren_image2 },
+    { "Draw", true, "text(_,_,_,_)", blink_wren_text },
+    { "Draw", true, "text(_,_,_,_,_)", blink_wren_text2 },
+    { "Input", true, "keyDown(_)", blink_wren_key_down },
+    { "Input", true, "keyPressed(_)", blink_wren_key_pressed },
+    { "Input", true, "keyReleased(_)", blink_wren_key_released },
+    { "Input", true, "mouseDown(_)", blink_wren_mouse_down },
+    { "Input", true, "mousePressed(_)", blink_wren_mouse_pressed },
+    { "Input", true, "mouseReleased(_)", blink_wren_mouse_released },
+    { "Input", true, "mouseX", blink_wren_mouse_x },
+    { "Input", true, "mouseY", blink_wren_mouse_y },
+    { "Input", true, "mouseScroll", blink_wren_mouse_scroll },
+};
+
+static WrenForeignMethodFn blink_wren_bind_method(WrenVM *vm, const char *module, const char *class_name, bool is_static, const char *signature) {
+    if (strcmp(module, "blink") != 0) { return NULL; }
+    for (int i = 0; i < blink_lengthof(blink_wren_methods); i++) {
+        if (blink_wren_methods[i].is_static == is_static &&
+            strcmp(blink_wren_methods[i].class_name, class_name) == 0 &&
+            strcmp(blink_wren_methods[i].signature, signature) == 0) {
+            return blink_wren_methods[i].fn;
+        }
+    }
+    return NULL;
+}
+
+static WrenForeignClassMethods blink_wren_bind_class(WrenVM *vm, const char *module, const char *class_name) {
+    WrenForeignClassMethods res = { NULL, NULL };
+    if (strcmp(module, "blink") != 0) { return res; }
+    if (strcmp(class_name, "Image") == 0) {
+        res.allocate = blink_wren_image_alloc;
+        res.finalize = blink_wren_free;
+    } else if (strcmp(class_name, "Font") == 0) {
+        res.allocate = blink_wren_font_alloc;
+        res.finalize = blink_wren_free;
+    }
+    return res;
+}
+
+static int blink_dir_length(const char *path) {
+    int len = 0;
+    for (int i = 0; path[i]; i++) {
+        if (path[i] == '/' || path[i] == '\\') { len = i + 1; }
+    }
+    return len;
+}
+
+/* imports resolve against the directory of the importing module, so
+ * "util" imported from assets/game.wren loads assets/util.wren */
+static const char *blink_wren_resolve_module(WrenVM *vm, const char *importer, const char *name) {
+    blink_Script *script = wrenGetUserData(vm);
+    const char *base = strcmp(importer, "main") == 0 ? script->dir : importer;
+    int base_len = blink_dir_length(base);
+    if (strcmp(name, "blink") == 0 || name[0] == '/' || name[0] == '\\' || (name[0] && name[1] == ':')) { base_len = 0; }
+    int len = strlen(name);
+    char *res = malloc(base_len + len + 1);
+    if (!res) { return NULL; }
+    memcpy(res, base, base_len);
+    memcpy(res + base_len, name, len + 1);
+    return res;
+}
+
+static void blink_wren_module_loaded(WrenVM *vm, const char *name, WrenLoadModuleResult result) {
+    if (result.userData) { free(result.userData); }
+}
+
+static WrenLoadModuleResult blink_wren_load_module(WrenVM *vm, const char *name) {
+    WrenLoadModuleResult res = { 0 };
+    if (strcmp(name, "blink") == 0) {
+        res.source = blink_wren_module;
+        return res;
+    }
+    char filename[512];
+    snprintf(filename, sizeof(filename), "%s.wren", name);
+    res.source = blink_read_file(filename, NULL);
+    res.userData = (void*) res.source;
+    res.onComplete = blink_wren_module_loaded;
+    return res;
+}
+
+static void blink_wren_write(WrenVM *vm, const char *text) {
+    fputs(text, stdout);
+}
+
+static void blink_wren_error(WrenVM *vm, WrenErrorType type, const char *module, int line, const char *msg) {
+    if (type == WREN_ERROR_RUNTIME) {
+        fprintf(stderr, "%s\n", msg);
+    } else if (type == WREN_ERROR_STACK_TRACE) {
+        fprintf(stderr, "[%s line %d] in %s\n", module, line, msg);
+    } else {
+        fprintf(stderr, "[%s line %d] %s\n", module, line, msg);
+    }
+}
+
+blink_Script *blink_load_script(blink_Context *ctx, const char *filename) {
+    char *source = blink_read_file(filename, NULL);
+    if (!source) { return NULL; }
+
+    blink_Script *script = blink_alloc(sizeof(blink_Script));
+    script->ctx = ctx;
+    snprintf(script->dir, sizeof(script->dir), "%.*s", blink_dir_length(filename), filename);
+
+    WrenConfiguration cfg;
+    wrenInitConfiguration(&cfg);
+    cfg.bindForeignMethodFn = blink_wren_bind_method;
+    cfg.bindForeignClassFn = blink_wren_bind_class;
+    cfg.resolveModuleFn = blink_wren_resolve_module;
+    cfg.loadModuleFn = blink_wren_load_module;
+    cfg.writeFn = blink_wren_write;
+    cfg.errorFn = blink_wren_error;
+    cfg.userData = script;
+    script->vm = wrenNewVM(&cfg);
+
+    WrenInterpretResult res = wrenInterpret(script->vm, "main", source);
+    free(source);
+    if (res != WREN_RESULT_SUCCESS || !wrenHasVariable(script->vm, "main", "Game")) {
+        if (res == WREN_RESULT_SUCCESS) { fprintf(stderr, "%s: no Game defined\n", filename); }
+        blink_destroy_script(script);
+        return NULL;
+    }
+
+    wrenEnsureSlots(script->vm, 1);
+    wrenGetVariable(script->vm, "main", "Game", 0);
+    script->game = wrenGetSlotHandle(script->vm, 0);
+    script->update = wrenMakeCallHandle(script->vm, "update(_)");
+    script->draw = wrenMakeCallHandle(script->vm, "draw()");
+    return script;
+}
+
+void blink_destroy_script(blink_Script *script) {
+    if (script->game) { wrenReleaseHandle(script->vm, script->game); }
+    if (script->update) { wrenReleaseHandle(script->vm, script->update); }
+    if (script->draw) { wrenReleaseHandle(script->vm, script->draw); }
+    wrenFreeVM(script->vm);
+    free(script);
+}
+
+bool blink_script_update(blink_Script *script, double dt) {
+    blink_profile_begin(script->ctx, "script update");
+    wrenEnsureSlots(script->vm, 2);
+    wrenSetSlotHandle(script->vm, 0, script->game);
+    wrenSetSlotDouble(script->vm, 1, dt);
+    bool res = wrenCall(script->vm, script->update) == WREN_RESULT_SUCCESS;
+    blink_profile_end(script->ctx);
+    return res;
+}
+
+bool blink_script_draw(blink_Script *script) {
+    blink_profile_begin(script->ctx, "script draw");
+    wrenEnsureSlots(script->vm, 1);
+    wrenSetSlotHandle(script->vm, 0, script->game);
+    bool res = wrenCall(script->vm, script->draw) == WREN_RESULT_SUCCESS;
+    blink_profile_end(script->ctx);
+    return res;
+}
+
 static char blink_font[] = {
     0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00,
     0x0d, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00,
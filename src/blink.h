@@ -9,15 +9,40 @@
 #include <stdarg.h>
 #include <time.h>
 #include <math.h>
+
+#if defined(_WIN32) && !defined(BLINK_HEADLESS)
+#define BLINK_WIN32
 #include <windows.h>
 #include <windowsx.h>
 #include <dwmapi.h>
+#endif
 
 typedef union { struct { uint8_t b, g, r, a; }; uint32_t w; } blink_Color;
 typedef struct { int x, y, w, h; } blink_Rect;
-typedef struct { blink_Color *pixels; int w, h; } blink_Image;
+typedef struct blink_Spans blink_Spans;
+typedef struct { blink_Color *pixels; int w, h, flags; blink_Spans *spans; } blink_Image;
 typedef struct { blink_Rect rect; int xadv; } blink_Glyph;
-typedef struct { blink_Image *image; blink_Glyph glyphs[256]; } blink_Font;
+typedef struct { blink_Image *image; blink_Glyph glyphs[256]; uint8_t *coverage; } blink_Font;
+/* blended counts pixels passed to a blend kernel, which may still store opaque
+ * source pixels as-is; copied counts pixels written by a plain copy or fill */
+typedef struct {
+    int point_calls, rect_calls, line_calls, image_calls, text_calls;
+    int glyphs;
+    int64_t touched, blended, copied, clipped;
+} blink_Stats;
+typedef struct blink_CommandBuffer blink_CommandBuffer;
+typedef struct blink_Pool blink_Pool;
+typedef struct blink_Profiler blink_Profiler;
+typedef struct blink_Atlas blink_Atlas;
+typedef struct blink_Loader blink_Loader;
+typedef struct blink_Load blink_Load;
+typedef struct blink_Pack blink_Pack;
+typedef struct blink_File blink_File;
+typedef struct blink_Audio blink_Audio;
+typedef struct blink_Music blink_Music;
+typedef struct blink_Sound blink_Sound;
+typedef struct blink_Script blink_Script;
+typedef struct { blink_Image *image; blink_Rect rect; } blink_Sprite;
 
 typedef struct {
     bool should_quit;
@@ -30,14 +55,43 @@ typedef struct {
     float mouse_scroll;
     double step_time;
     double prev_time;
+    double sleep_error;
+    void (*fixed_update)(void *udata, double dt);
+    void *fixed_udata;
+    double fixed_step;
+    double accumulator;
+    int max_steps;
     blink_Image *screen;
     blink_Rect clip;
+    blink_Rect dirty[16];
+    int dirty_count;
     blink_Font *font;
+    bool deferred;
+    blink_CommandBuffer *commands;
+    blink_Pool *pool;
+    blink_Profiler *profiler;
+    blink_Loader *loader;
+    blink_Audio *audio;
+    blink_Stats stats;
+    blink_Stats prev_stats;
     int width, height;
+#ifdef BLINK_WIN32
     HWND hwnd;
     HDC hdc;
+#endif
 } blink_Context;
 
+enum {
+    BLINK_IMAGE_PREMULTIPLIED = (1 << 0),
+    BLINK_IMAGE_SPANS = (1 << 1),
+    BLINK_IMAGE_MAPPED = (1 << 2)
+};
+
+enum {
+    BLINK_AUDIO_NULL = (1 << 0),
+    BLINK_AUDIO_OFFLINE = (1 << 1)
+};
+
 #define blink_max(a, b) ((a) > (b) ? (a) : (b))
 #define blink_min(a, b) ((a) < (b) ? (a) : (b))
 #define blink_lengthof(a) (sizeof(a) / sizeof((a)[0]))
@@ -52,14 +106,41 @@ typedef struct {
 blink_Context *blink_create(const char *title, int width, int height, int scale);
 void blink_destroy(blink_Context *ctx);
 bool blink_update(blink_Context *ctx, double *dt);
+double blink_get_time(void);
 void blink_set_target_fps(blink_Context *ctx, int fps);
+void blink_set_fixed_update(blink_Context *ctx, void (*fn)(void *udata, double dt), void *udata, int rate, int max_steps);
+double blink_get_alpha(blink_Context *ctx);
 void blink_set_cursor_hidden(blink_Context *ctx, bool hidden);
+blink_File *blink_open_file(const char *filename);
+const void *blink_file_data(blink_File *f);
+size_t blink_file_size(blink_File *f);
+void blink_close_file(blink_File *f);
 void *blink_read_file(const char *filename, int *len);
+blink_Pack *blink_mount_pack(const char *filename);
+void blink_unmount_pack(blink_Pack *pack);
 
 blink_Image *blink_create_image(int width, int height);
 blink_Image *blink_load_image_mem(void *data, int len);
+blink_Image *blink_load_image_mem2(void *data, int len, int flags);
 blink_Image *blink_load_image_file(const char *filename);
+blink_Image *blink_load_image_file2(const char *filename, int flags);
+int blink_load_images_mem(void **data, int *lens, int count, int flags, blink_Image **out);
+int blink_load_images_file(const char **filenames, int count, int flags, blink_Image **out);
+void blink_build_image_spans(blink_Image *img);
 void blink_destroy_image(blink_Image *img);
+bool blink_save_image(blink_Image *img, const char *filename);
+int blink_compare_images(blink_Image *a, blink_Image *b, int tolerance, blink_Image *diff);
+bool blink_save_bimg(blink_Image *img, const char *filename);
+blink_Image *blink_load_bimg(const char *filename);
+
+blink_Atlas *blink_create_atlas(int width, int height, int flags);
+void blink_destroy_atlas(blink_Atlas *atlas);
+blink_Sprite blink_atlas_add(blink_Atlas *atlas, blink_Image *img);
+blink_Sprite blink_atlas_load_file(blink_Atlas *atlas, const char *filename);
+
+blink_Load *blink_load_image_async(blink_Context *ctx, const char *filename, int flags);
+bool blink_load_ready(blink_Load *load);
+blink_Image *blink_finish_load(blink_Load *load);
 
 blink_Font *blink_load_font_mem(void *data, int len);
 blink_Font *blink_load_font_file(const char *filename);
@@ -77,6 +158,16 @@ bool blink_mouse_pressed(blink_Context *ctx, int button);
 bool blink_mouse_released(blink_Context *ctx, int button);
 float blink_mouse_scroll(blink_Context *ctx);
 
+void blink_set_deferred(blink_Context *ctx, bool deferred);
+void blink_flush(blink_Context *ctx);
+void blink_set_threads(blink_Context *ctx, int count);
+
+void blink_set_profiling(blink_Context *ctx, bool enabled);
+void blink_profile_begin(blink_Context *ctx, const char *name);
+void blink_profile_end(blink_Context *ctx);
+void blink_draw_profile(blink_Context *ctx, int x, int y);
+bool blink_save_profile(blink_Context *ctx, const char *filename);
+
 void blink_clear(blink_Context *ctx, blink_Color color);
 void blink_set_clip(blink_Context *ctx, blink_Rect rect);
 void blink_draw_point(blink_Context *ctx, int x, int y, blink_Color color);
@@ -88,4 +179,28 @@ void blink_draw_image3(blink_Context *ctx, blink_Image *img, blink_Rect dst, bli
 int blink_draw_text(blink_Context *ctx, const char *text, int x, int y, blink_Color color);
 int blink_draw_text2(blink_Context *ctx, blink_Font *font, const char *text, int x, int y, blink_Color color);
 
+bool blink_open_audio(blink_Context *ctx, int flags);
+void blink_render_audio(blink_Context *ctx, float *out, int frames);
+blink_Music *blink_load_music(blink_Context *ctx, const char *filename);
+void blink_destroy_music(blink_Music *music);
+void blink_play_music(blink_Context *ctx, blink_Music *music, bool loop);
+void blink_stop_music(blink_Context *ctx);
+bool blink_music_playing(blink_Context *ctx);
+void blink_set_music_volume(blink_Context *ctx, float volume);
+blink_Sound *blink_create_sound(const float *samples, int frames, int channels);
+blink_Sound *blink_load_sound_mem(void *data, int len);
+blink_Sound *blink_load_sound_file(const char *filename);
+blink_Sound *blink_retain_sound(blink_Sound *sound);
+void blink_destroy_sound(blink_Sound *sound);
+uint32_t blink_play_sound(blink_Context *ctx, blink_Sound *sound);
+uint32_t blink_play_sound2(blink_Context *ctx, blink_Sound *sound, float gain, float pan, float pitch, int priority, bool loop);
+void blink_set_voice(blink_Context *ctx, uint32_t voice, float gain, float pan, float pitch);
+void blink_stop_voice(blink_Context *ctx, uint32_t voice);
+bool blink_voice_playing(blink_Context *ctx, uint32_t voice);
+
+blink_Script *blink_load_script(blink_Context *ctx, const char *filename);
+void blink_destroy_script(blink_Script *script);
+bool blink_script_update(blink_Script *script, double dt);
+bool blink_script_draw(blink_Script *script);
+
 #endif
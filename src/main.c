@@ -1,8 +1,18 @@
 #include "blink.h"
 
-int main() {
+int main(int argc, char **argv) {
     blink_Context *ctx = blink_create("Hello blink", 320, 240, 2);
 
+    if (argc > 1) {
+        blink_Script *script = blink_load_script(ctx, argv[1]);
+        if (!script) { return 1; }
+        double dt;
+        while (blink_update(ctx, &dt) && blink_script_update(script, dt) && blink_script_draw(script)) {}
+        blink_destroy_script(script);
+        blink_destroy(ctx);
+        return 0;
+    }
+
     blink_Image *squinkle = blink_load_image_file("assets/squinkle.png");
 
     double dt;
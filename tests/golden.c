@@ -0,0 +1,207 @@
+#include "blink.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SCREEN_W 160
+#define SCREEN_H 120
+#define GOLDEN_DIR "tests/golden"
+
+typedef struct {
+    blink_Image *sprite;
+    blink_Image *sprite_pm;
+    blink_Image *sprite_spans;
+    blink_Image *glow;
+    blink_Image *halo_spans;
+} Assets;
+
+static void scene_shapes(blink_Context *ctx, Assets *a) {
+    (void) a;
+    blink_clear(ctx, blink_rgb(0x20, 0x30, 0x40));
+    for (int i = 0; i < 24; i++) {
+        blink_Rect r = blink_rect((i * 37) % (SCREEN_W + 20) - 10, (i * 23) % (SCREEN_H + 10) - 5, 3 + i * 2, 5 + i % 9);
+        blink_draw_rect(ctx, r, blink_rgba(i * 10, 0xff - i * 7, i * 3, i % 3 ? 0x80 + i * 5 : 0xff));
+    }
+    for (int i = 0; i < 16; i++) {
+        blink_draw_line(ctx, i * 10, 0, SCREEN_W - 1 - i * 3, SCREEN_H - 1, blink_rgba(0xff, 0xff, 0, 0x60 + i * 8));
+        blink_draw_line(ctx, -20, i * 8, SCREEN_W + 20, SCREEN_H - i * 8, blink_rgb(0, 0xc0, 0xff));
+        blink_draw_point(ctx, i * 9 + 3, i * 7 + 2, blink_rgb(0xff, 0, 0));
+    }
+    blink_set_clip(ctx, blink_rect(30, 20, 100, 80));
+    blink_draw_rect(ctx, blink_rect(0, 0, SCREEN_W, SCREEN_H), blink_rgba(0xff, 0xff, 0xff, 0x40));
+    blink_set_clip(ctx, blink_rect(0, 0, SCREEN_W, SCREEN_H));
+}
+
+static void scene_images(blink_Context *ctx, Assets *a) {
+    blink_Image *img = a->sprite;
+    blink_Rect src = blink_rect(0, 0, img->w, img->h);
+    blink_clear(ctx, blink_rgb(0xf0, 0xf0, 0xe0));
+    blink_draw_image(ctx, img, 4, 4);
+    blink_draw_image(ctx, img, SCREEN_W - img->w / 2, -img->h / 3);
+    blink_draw_image2(ctx, img, 60, 10, blink_rect(img->w - 1, 0, -img->w, img->h), blink_rgba(0x80, 0xc0, 0xff, 0xc0));
+    blink_draw_image3(ctx, img, blink_rect(10, 60, 70, 50), src, BLINK_WHITE, BLINK_BLACK);
+    blink_draw_image3(ctx, img, blink_rect(90, 60, 23, 57), src, blink_rgba(0xff, 0x80, 0x40, 0xc0), blink_rgb(0x30, 0, 0x20));
+    blink_set_clip(ctx, blink_rect(100, 0, 45, 50));
+    blink_draw_image3(ctx, img, blink_rect(95, 5, 60, 60), src, blink_rgba(0xff, 0xff, 0xff, 0x90), BLINK_BLACK);
+    blink_set_clip(ctx, blink_rect(0, 0, SCREEN_W, SCREEN_H));
+    blink_draw_image(ctx, a->sprite_spans, 120, 70);
+}
+
+static void scene_premultiplied(blink_Context *ctx, Assets *a) {
+    blink_clear(ctx, blink_rgb(0x10, 0x10, 0x30));
+    blink_Image *img = a->sprite_pm;
+    blink_draw_image(ctx, img, 3, 3);
+    blink_draw_image3(ctx, img, blink_rect(50, 3, 41, 37), blink_rect(0, 0, img->w, img->h), blink_rgba(0xff, 0xc0, 0x80, 0xd0), BLINK_BLACK);
+    blink_draw_image3(ctx, img, blink_rect(100, 3, 37, 41), blink_rect(0, 0, img->w, img->h), blink_rgba(0xff, 0xff, 0xff, 0xa0), blink_rgb(0x40, 0x20, 0));
+
+    /* additive glow: rgb > a and a == 0 pixels, drawn with odd widths so
+     * every SIMD tail length is exercised */
+    blink_Image *glow = a->glow;
+    for (int i = 0; i < 13; i++) {
+        int x = 3 + i * 12, y = 60 + (i % 3) * 17;
+        blink_draw_image2(ctx, glow, x, y, blink_rect(i % 4, 0, glow->w - i % 4 * 2 - 1 + i % 2, glow->h), BLINK_WHITE);
+        blink_draw_image2(ctx, glow, x + 2, y + 5, blink_rect(0, 0, 1 + i, glow->h), blink_rgba(0x80, 0xff, 0xc0, 0xff));
+    }
+
+    /* long a == 0 runs must not be classified as skippable spans */
+    blink_Image *halo = a->halo_spans;
+    blink_draw_image(ctx, halo, 2, 44);
+    blink_draw_image3(ctx, halo, blink_rect(80, 44, 70, 9), blink_rect(0, 0, halo->w, halo->h), BLINK_WHITE, BLINK_BLACK);
+}
+
+static void scene_text(blink_Context *ctx, Assets *a) {
+    (void) a;
+    blink_clear(ctx, BLINK_WHITE);
+    for (int i = 0; i < 12; i++) {
+        blink_draw_text(ctx, "The quick brown fox jumps", i * 3 - 10, i * 10, blink_rgba(i * 20, 0, 0x80, 0xff - i * 12));
+    }
+    blink_set_clip(ctx, blink_rect(20, 30, 80, 40));
+    blink_draw_text(ctx, "clipped text runs off the edge", 0, 40, BLINK_BLACK);
+    blink_set_clip(ctx, blink_rect(0, 0, SCREEN_W, SCREEN_H));
+}
+
+static const struct {
+    const char *name;
+    void (*fn)(blink_Context *ctx, Assets *a);
+} scenes[] = {
+    { "shapes", scene_shapes },
+    { "images", scene_images },
+    { "premultiplied", scene_premultiplied },
+    { "text", scene_text },
+};
+
+static const struct {
+    const char *name;
+    bool deferred;
+    int threads;
+} modes[] = {
+    { "immediate", false, 1 },
+    { "deferred", true, 1 },
+    { "tiled", true, 4 },
+};
+
+static blink_Image *make_glow(void) {
+    blink_Image *img = blink_create_image(21, 15);
+    for (int y = 0; y < img->h; y++) {
+        for (int x = 0; x < img->w; x++) {
+            int dx = x - 10, dy = y - 7;
+            int v = blink_max(0, 0xff - (dx * dx + dy * dy) * 3);
+            img->pixels[x + y * img->w] = blink_rgba(v, v / 2, v / 4, v / 8);
+        }
+    }
+    img->flags = BLINK_IMAGE_PREMULTIPLIED;
+    return img;
+}
+
+static blink_Image *make_halo_spans(void) {
+    blink_Image *img = blink_create_image(40, 6);
+    for (int y = 0; y < img->h; y++) {
+        for (int x = 0; x < img->w; x++) {
+            int v = x * 6 + y * 4;
+            img->pixels[x + y * img->w] = y == 5 ? blink_rgba(0, 0, 0, 0) : blink_rgba(v, v / 2, 0xff - v, y == 2 && x > 16 && x < 24 ? 0x80 : 0);
+        }
+    }
+    img->flags = BLINK_IMAGE_PREMULTIPLIED;
+    blink_build_image_spans(img);
+    return img;
+}
+
+int main(int argc, char **argv) {
+    bool update = argc > 1 && !strcmp(argv[1], "-u");
+    if (argc > 1 && !update) {
+        fprintf(stderr, "usage: golden [-u]\n");
+        fprintf(stderr, "  -u  rewrite the reference images in " GOLDEN_DIR "\n");
+        return 1;
+    }
+
+    blink_Context *ctx = blink_create("golden", SCREEN_W, SCREEN_H, 1);
+    Assets a = {
+        blink_load_image_file("assets/squinkle.png"),
+        blink_load_image_file2("assets/squinkle.png", BLINK_IMAGE_PREMULTIPLIED),
+        blink_load_image_file2("assets/squinkle.png", BLINK_IMAGE_SPANS),
+        make_glow(),
+        make_halo_spans(),
+    };
+    if (!a.sprite || !a.sprite_pm || !a.sprite_spans) {
+        fprintf(stderr, "golden: failed to load assets/squinkle.png (run from the repo root)\n");
+        return 1;
+    }
+
+    int failed = 0;
+    char path[256];
+    for (int i = 0; i < (int) blink_lengthof(scenes); i++) {
+        snprintf(path, sizeof(path), GOLDEN_DIR "/%s.png", scenes[i].name);
+        blink_Image *ref = update ? NULL : blink_load_image_file(path);
+        if (!update && !ref) {
+            printf("FAIL %s: missing %s\n", scenes[i].name, path);
+            failed++;
+            continue;
+        }
+
+        for (int m = 0; m < (int) blink_lengthof(modes); m++) {
+            blink_set_threads(ctx, modes[m].threads);
+            blink_set_deferred(ctx, modes[m].deferred);
+            scenes[i].fn(ctx, &a);
+            blink_flush(ctx);
+
+            if (update) {
+                if (!blink_save_image(ctx->screen, path)) {
+                    printf("FAIL %s: cannot write %s\n", scenes[i].name, path);
+                    failed++;
+                } else {
+                    printf("wrote %s\n", path);
+                }
+                break;
+            }
+
+            blink_Image *diff = blink_create_image(SCREEN_W, SCREEN_H);
+            int count = blink_compare_images(ctx->screen, ref, 0, diff);
+            if (count != 0) {
+                printf("FAIL %s (%s): ", scenes[i].name, modes[m].name);
+                if (count < 0) {
+                    printf("size mismatch\n");
+                } else {
+                    printf("%d pixels differ\n", count);
+                    snprintf(path, sizeof(path), GOLDEN_DIR "/%s_diff.png", scenes[i].name);
+                    blink_save_image(diff, path);
+                    snprintf(path, sizeof(path), GOLDEN_DIR "/%s_out.png", scenes[i].name);
+                    blink_save_image(ctx->screen, path);
+                    printf("     wrote %s_diff.png and %s_out.png\n", scenes[i].name, scenes[i].name);
+                }
+                failed++;
+                blink_destroy_image(diff);
+                break;
+            }
+            blink_destroy_image(diff);
+            printf("ok   %s (%s)\n", scenes[i].name, modes[m].name);
+        }
+        if (ref) { blink_destroy_image(ref); }
+    }
+
+    blink_destroy_image(a.sprite);
+    blink_destroy_image(a.sprite_pm);
+    blink_destroy_image(a.sprite_spans);
+    blink_destroy_image(a.glow);
+    blink_destroy_image(a.halo_spans);
+    blink_destroy(ctx);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+#include "blink.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SCREEN_W 640
+#define SCREEN_H 480
+
+typedef struct {
+    blink_Image *sprite;
+    blink_Image *sprite_pm;
+    int i;
+} Bench;
+
+static void bench_clear(blink_Context *ctx, Bench *b) {
+    blink_clear(ctx, blink_rgb(b->i, 0x20, 0x40));
+}
+
+static void bench_rect(blink_Context *ctx, int size, int alpha, Bench *b) {
+    int x = (b->i * 37) % (SCREEN_W - size + 1);
+    int y = (b->i * 53) % (SCREEN_H - size + 1);
+    blink_draw_rect(ctx, blink_rect(x, y, size, size), blink_rgba(0xff, b->i, 0x80, alpha));
+}
+
+static void bench_rect_8(blink_Context *ctx, Bench *b) { bench_rect(ctx, 8, 0xff, b); }
+static void bench_rect_64(blink_Context *ctx, Bench *b) { bench_rect(ctx, 64, 0xff, b); }
+static void bench_rect_256(blink_Context *ctx, Bench *b) { bench_rect(ctx, 256, 0xff, b); }
+static void bench_rect_alpha_8(blink_Context *ctx, Bench *b) { bench_rect(ctx, 8, 0x80, b); }
+static void bench_rect_alpha_64(blink_Context *ctx, Bench *b) { bench_rect(ctx, 64, 0x80, b); }
+static void bench_rect_alpha_256(blink_Context *ctx, Bench *b) { bench_rect(ctx, 256, 0x80, b); }
+
+static void bench_line_short(blink_Context *ctx, Bench *b) {
+    int x = (b->i * 37) % (SCREEN_W - 32);
+    int y = (b->i * 53) % (SCREEN_H - 32);
+    blink_draw_line(ctx, x, y, x + 31, y + (b->i & 31), blink_rgba(0, 0, 0xff, 0xc0));
+}
+
+static void bench_line_long(blink_Context *ctx, Bench *b) {
+    int x = b->i % SCREEN_W;
+    blink_draw_line(ctx, x, 0, SCREEN_W - 1 - x, SCREEN_H - 1, blink_rgba(0, 0, 0xff, 0xc0));
+}
+
+static void bench_image(blink_Context *ctx, blink_Image *img, blink_Rect dst, blink_Color mul, blink_Color add) {
+    blink_draw_image3(ctx, img, dst, blink_rect(0, 0, img->w, img->h), mul, add);
+}
+
+static blink_Rect bench_dst(Bench *b, int w, int h) {
+    return blink_rect((b->i * 37) % (SCREEN_W - w + 1), (b->i * 53) % (SCREEN_H - h + 1), w, h);
+}
+
+static void bench_image_1x(blink_Context *ctx, Bench *b) {
+    bench_image(ctx, b->sprite, bench_dst(b, 64, 64), BLINK_WHITE, BLINK_BLACK);
+}
+
+static void bench_image_scaled(blink_Context *ctx, Bench *b) {
+    bench_image(ctx, b->sprite, bench_dst(b, 160, 160), BLINK_WHITE, BLINK_BLACK);
+}
+
+static void bench_image_mul(blink_Context *ctx, Bench *b) {
+    bench_image(ctx, b->sprite, bench_dst(b, 64, 64), blink_rgba(0xff, 0x80, 0x40, 0xc0), BLINK_BLACK);
+}
+
+static void bench_image_mul_add(blink_Context *ctx, Bench *b) {
+    bench_image(ctx, b->sprite, bench_dst(b, 64, 64), blink_rgba(0xff, 0x80, 0x40, 0xc0), blink_rgb(0x20, 0x10, 0));
+}
+
+static void bench_image_clipped(blink_Context *ctx, Bench *b) {
+    blink_Rect dst = blink_rect(SCREEN_W - 32, (b->i * 53) % (SCREEN_H - 32), 64, 64);
+    bench_image(ctx, b->sprite, dst, BLINK_WHITE, BLINK_BLACK);
+}
+
+static void bench_image_pm(blink_Context *ctx, Bench *b) {
+    bench_image(ctx, b->sprite_pm, bench_dst(b, 64, 64), BLINK_WHITE, BLINK_BLACK);
+}
+
+static void bench_text(blink_Context *ctx, Bench *b) {
+    int y = (b->i * 53) % (SCREEN_H - 16);
+    blink_draw_text2(ctx, ctx->font, "The quick brown fox jumps over the lazy dog", 8, y, blink_rgb(b->i, 0xff, 0xff));
+}
+
+static const struct {
+    const char *name;
+    void (*fn)(blink_Context *ctx, Bench *b);
+} benches[] = {
+    { "clear", bench_clear },
+    { "rect_8", bench_rect_8 },
+    { "rect_64", bench_rect_64 },
+    { "rect_256", bench_rect_256 },
+    { "rect_alpha_8", bench_rect_alpha_8 },
+    { "rect_alpha_64", bench_rect_alpha_64 },
+    { "rect_alpha_256", bench_rect_alpha_256 },
+    { "line_short", bench_line_short },
+    { "line_long", bench_line_long },
+    { "image_1x", bench_image_1x },
+    { "image_scaled", bench_image_scaled },
+    { "image_mul", bench_image_mul },
+    { "image_mul_add", bench_image_mul_add },
+    { "image_clipped", bench_image_clipped },
+    { "image_premultiplied", bench_image_pm },
+    { "text", bench_text },
+};
+
+static blink_Image *make_sprite(int flags) {
+    blink_Image *img = blink_create_image(64, 64);
+    for (int y = 0; y < img->h; y++) {
+        for (int x = 0; x < img->w; x++) {
+            int dx = x - 32, dy = y - 32;
+            int a = blink_max(0, 0xff - (dx * dx + dy * dy) / 4);
+            blink_Color c = blink_rgba(x * 4, y * 4, 0x80, a);
+            if (flags & BLINK_IMAGE_PREMULTIPLIED) {
+                c = blink_rgba(c.r * a / 255, c.g * a / 255, c.b * a / 255, a);
+            }
+            img->pixels[x + y * img->w] = c;
+        }
+    }
+    img->flags = flags;
+    return img;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    double min_time = argc > 2 ? atof(argv[2]) : 0.25;
+
+    blink_Context *ctx = blink_create("bench", SCREEN_W, SCREEN_H, 1);
+    Bench b = { make_sprite(0), make_sprite(BLINK_IMAGE_PREMULTIPLIED), 0 };
+
+    for (int i = 0; i < (int) blink_lengthof(benches); i++) {
+        if (filter && !strstr(benches[i].name, filter)) { continue; }
+
+        int batch = 64;
+        for (b.i = 0; b.i < batch; b.i++) { benches[i].fn(ctx, &b); }
+
+        memset(&ctx->stats, 0, sizeof(ctx->stats));
+        long calls = 0;
+        double start = blink_get_time(), elapsed;
+        do {
+            for (int j = 0; j < batch; j++, b.i++) { benches[i].fn(ctx, &b); }
+            calls += batch;
+            elapsed = blink_get_time() - start;
+            if (elapsed < min_time / 16) { batch *= 2; }
+        } while (elapsed < min_time);
+
+        printf("{\"name\":\"%s\",\"calls\":%ld,\"ns_per_call\":%.1f,\"mpix_per_s\":%.1f}\n",
+            benches[i].name, calls, elapsed * 1e9 / calls, ctx->stats.touched / elapsed / 1e6);
+    }
+
+    blink_destroy_image(b.sprite);
+    blink_destroy_image(b.sprite_pm);
+    blink_destroy(ctx);
+    return 0;
+}
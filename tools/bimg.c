@@ -0,0 +1,36 @@
+#include "blink.h"
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+    int flags = 0;
+    const char *files[2];
+    int count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-p")) {
+            flags |= BLINK_IMAGE_PREMULTIPLIED;
+        } else if (!strcmp(argv[i], "-s")) {
+            flags |= BLINK_IMAGE_SPANS;
+        } else if (count < 2) {
+            files[count++] = argv[i];
+        }
+    }
+    if (count != 2) {
+        fprintf(stderr, "usage: bimg [-p] [-s] input.png output.bimg\n");
+        fprintf(stderr, "  -p  store premultiplied alpha\n");
+        fprintf(stderr, "  -s  store span metadata\n");
+        return 1;
+    }
+
+    blink_Image *img = blink_load_image_file2(files[0], flags);
+    if (!img) {
+        fprintf(stderr, "bimg: failed to load %s\n", files[0]);
+        return 1;
+    }
+    if (!blink_save_bimg(img, files[1])) {
+        fprintf(stderr, "bimg: failed to write %s\n", files[1]);
+        return 1;
+    }
+    blink_destroy_image(img);
+    return 0;
+}